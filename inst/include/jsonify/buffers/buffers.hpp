@@ -0,0 +1,99 @@
+#ifndef R_JSONIFY_BUFFERS_H
+#define R_JSONIFY_BUFFERS_H
+
+#include <Rcpp.h>
+#include <memory>
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace buffers {
+
+  /*
+   * Each thread keeps a buffer, writer and reader between calls, so once the
+   * buffer has grown to the size of the JSON being written it isn't allocated
+   * and freed again on every call. Their stacks are kept too.
+   *
+   * A buffer which held more than this is freed at the end of the call, so a
+   * one-off large result isn't kept for the life of the session
+   */
+  const size_t MAX_POOLED_SIZE = 64 * 1024 * 1024;
+
+  typedef rapidjson::Writer< rapidjson::StringBuffer > writer_type;
+
+  struct slot {
+    rapidjson::StringBuffer sb;
+    writer_type writer;
+    rapidjson::Reader reader;
+    bool in_use;
+
+    slot() : writer( sb ), in_use( false ) {}
+
+    void release() {
+      sb.Clear();
+      sb.ShrinkToFit();
+    }
+  };
+
+  inline slot& thread_slot() {
+    static thread_local slot s;
+    return s;
+  }
+
+  /*
+   * Borrows the thread's slot for the life of the lease. If the slot is
+   * already borrowed (e.g. to_json() called while another call is writing) a
+   * new one is used instead, so leases can be nested. That slot isn't pooled;
+   * its buffer is allocated as it's written and freed when the lease ends
+   */
+  class lease {
+  public:
+    lease() : s( &thread_slot() ) {
+      if ( s -> in_use ) {
+        own.reset( new slot() );
+        s = own.get();
+      }
+      s -> in_use = true;
+      s -> sb.Clear();
+      s -> writer.Reset( s -> sb );
+    }
+
+    ~lease() {
+      if ( s -> sb.GetSize() > MAX_POOLED_SIZE ) {
+        s -> release();
+      } else {
+        s -> sb.Clear();
+      }
+      s -> in_use = false;
+    }
+
+    rapidjson::StringBuffer& buffer() { return s -> sb; }
+    writer_type& writer() { return s -> writer; }
+    rapidjson::Reader& reader() { return s -> reader; }
+
+  private:
+    slot* s;
+    std::unique_ptr< slot > own;
+
+    lease( const lease& );
+    lease& operator=( const lease& );
+  };
+
+  /*
+   * frees the memory held by the calling thread's buffer
+   */
+  inline void release() {
+    slot& s = thread_slot();
+    if ( !s.in_use ) {
+      s.release();
+    }
+  }
+
+} // namespace buffers
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef R_JSONIFY_COMBINE_H
+#define R_JSONIFY_COMBINE_H
+
+#include <Rcpp.h>
+#include <string>
+#include "jsonify/buffers/buffers.hpp"
+#include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+#include "jsonify/validate/validate.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace combine {
+
+  /*
+   * whether every element has a name, so the fragments can be keyed by them
+   */
+  inline bool all_named( SEXP names ) {
+    R_xlen_t i;
+    if ( Rf_isNull( names ) ) {
+      return false;
+    }
+    for ( i = 0; i < Rf_xlength( names ); i++ ) {
+      SEXP name = STRING_ELT( names, i );
+      if ( name == NA_STRING || LENGTH( name ) == 0 ) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * Combines fragments of JSON into one array or, if every fragment is named,
+   * one object keyed by the names. The fragments are copied, not parsed, so
+   * unless 'validate' is true they are assumed to be valid. NA is null
+   */
+  inline Rcpp::StringVector json_combine( Rcpp::StringVector json, bool validate = false ) {
+
+    R_xlen_t i;
+    R_xlen_t n = json.size();
+    SEXP names = Rf_getAttrib( json, R_NamesSymbol );
+    bool has_names = all_named( names );
+
+    if ( validate ) {
+      for ( i = 0; i < n; i++ ) {
+        SEXP s = STRING_ELT( json, i );
+        if ( s != NA_STRING && !jsonify::validate::validate_json( CHAR( s ) ) ) {
+          Rcpp::stop( "jsonify - element " + std::to_string( i + 1 ) + " is not valid JSON" );
+        }
+      }
+    }
+
+    jsonify::buffers::lease lease;
+    jsonify::buffers::writer_type& writer = lease.writer();
+
+    jsonify::utils::writer_starter( writer, has_names );
+    for ( i = 0; i < n; i++ ) {
+      if ( has_names ) {
+        SEXP name = STRING_ELT( names, i );
+        writer.String( CHAR( name ), LENGTH( name ) );
+      }
+      jsonify::writers::scalars::write_json( writer, STRING_ELT( json, i ) );
+    }
+    jsonify::utils::writer_ender( writer, has_names );
+
+    return jsonify::utils::finalise_json( lease.buffer() );
+  }
+
+} // namespace combine
+} // namespace jsonify
+
+#endif
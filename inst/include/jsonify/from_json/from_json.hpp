@@ -0,0 +1,636 @@
+#ifndef R_JSONIFY_FROM_JSON_H
+#define R_JSONIFY_FROM_JSON_H
+
+#include <Rcpp.h>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <vector>
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/reader.h"
+#include "rapidjson/error/en.h"
+
+/*
+ * Converts JSON to R objects while it's being parsed (SAX), without building a
+ * rapidjson::Document first
+ *
+ * When simplifying
+ * - an array of scalars becomes an atomic vector
+ * - an array of objects whose values are all scalars becomes a data.frame
+ * - anything else is a list
+ *
+ * Values are promoted logical < integer < double < character. Numbers are parsed
+ * as strings (kParseNumbersAsStringsFlag) so that when a number is promoted
+ * to character it keeps the text it had in the JSON.
+ */
+
+namespace jsonify {
+namespace from_json {
+
+  // ---------------------------------------------------------------------------
+  // protection
+  // ---------------------------------------------------------------------------
+
+  /*
+   * Keeps every R object created during the parse protected until the parse
+   * has finished, without using the PROTECT stack (which is limited in depth)
+   */
+  class protect_stack {
+  public:
+    protect_stack() : n( 0 ) {
+      pool = Rf_allocVector( VECSXP, 64 );
+      R_PreserveObject( pool );
+    }
+
+    ~protect_stack() {
+      R_ReleaseObject( pool );
+    }
+
+    inline SEXP push( SEXP x ) {
+      if ( n == Rf_xlength( pool ) ) {
+        PROTECT( x );
+        R_xlen_t i;
+        SEXP bigger = Rf_allocVector( VECSXP, n * 2 );
+        R_PreserveObject( bigger );
+        for ( i = 0; i < n; i++ ) {
+          SET_VECTOR_ELT( bigger, i, VECTOR_ELT( pool, i ) );
+        }
+        R_ReleaseObject( pool );
+        pool = bigger;
+        UNPROTECT( 1 );
+      }
+      SET_VECTOR_ELT( pool, n++, x );
+      return x;
+    }
+
+  private:
+    SEXP pool;
+    R_xlen_t n;
+  };
+
+  // ---------------------------------------------------------------------------
+  // scalars
+  // ---------------------------------------------------------------------------
+
+  /*
+   * the order of these is the order in which values are promoted
+   * JSON_MISSING is a key which wasn't in one of the objects of a data.frame
+   */
+  enum scalar_type { JSON_MISSING = 0, JSON_NULL, JSON_LOGICAL, JSON_INTEGER, JSON_DOUBLE, JSON_STRING };
+
+  /*
+   * a scalar value; strings, and the text of numbers, are held in the parser's
+   * string arena
+   */
+  struct scalar {
+    scalar_type type;
+    int i;
+    double d;
+    size_t offset;
+    size_t length;
+  };
+
+  inline SEXP make_string( const std::string& arena, const scalar& s ) {
+    return Rf_mkCharLenCE( arena.data() + s.offset, static_cast< int >( s.length ), CE_UTF8 );
+  }
+
+  inline SEXP scalar_to_string( const std::string& arena, const scalar& s ) {
+    switch( s.type ) {
+    case JSON_LOGICAL: return Rf_mkChar( s.i ? "TRUE" : "FALSE" );
+    case JSON_INTEGER: {}
+    case JSON_DOUBLE: {}
+    case JSON_STRING: return make_string( arena, s );
+    default: return NA_STRING;
+    }
+  }
+
+  /*
+   * a single value as a length-1 vector (or NULL)
+   */
+  inline SEXP scalar_to_sexp( const std::string& arena, const scalar& s ) {
+    switch( s.type ) {
+    case JSON_LOGICAL: return Rf_ScalarLogical( s.i );
+    case JSON_INTEGER: return Rf_ScalarInteger( s.i );
+    case JSON_DOUBLE: return Rf_ScalarReal( s.d );
+    case JSON_STRING: return Rf_ScalarString( make_string( arena, s ) );
+    default: return R_NilValue;
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // columns
+  // ---------------------------------------------------------------------------
+
+  /*
+   * Collects the values of an array of scalars, or of one key of an array of
+   * objects, and tracks the type they will need once they're all known
+   */
+  struct column {
+    std::string name;
+    std::vector< scalar > values;
+    scalar_type type;
+
+    column() : type( JSON_MISSING ) {}
+
+    inline void push( const scalar& s ) {
+      values.push_back( s );
+      if ( s.type > type ) {
+        type = s.type;
+      }
+    }
+
+    inline void push_missing() {
+      scalar s;
+      s.type = JSON_MISSING;
+      values.push_back( s );
+    }
+
+    inline SEXP to_vector( const std::string& arena ) const {
+      R_xlen_t i;
+      R_xlen_t n = values.size();
+      SEXP res;
+
+      switch( type ) {
+      case JSON_STRING: {
+        res = PROTECT( Rf_allocVector( STRSXP, n ) );
+        for ( i = 0; i < n; i++ ) {
+          SET_STRING_ELT( res, i, scalar_to_string( arena, values[i] ) );
+        }
+        break;
+      }
+      case JSON_DOUBLE: {
+        res = PROTECT( Rf_allocVector( REALSXP, n ) );
+        double* p = REAL( res );
+        for ( i = 0; i < n; i++ ) {
+          const scalar& s = values[i];
+          p[i] = s.type == JSON_DOUBLE ? s.d : ( s.type < JSON_LOGICAL ? NA_REAL : static_cast< double >( s.i ) );
+        }
+        break;
+      }
+      case JSON_INTEGER: {
+        res = PROTECT( Rf_allocVector( INTSXP, n ) );
+        int* p = INTEGER( res );
+        for ( i = 0; i < n; i++ ) {
+          p[i] = values[i].type < JSON_LOGICAL ? NA_INTEGER : values[i].i;
+        }
+        break;
+      }
+      default: {
+        // logical, or all null
+        res = PROTECT( Rf_allocVector( LGLSXP, n ) );
+        int* p = LOGICAL( res );
+        for ( i = 0; i < n; i++ ) {
+          p[i] = values[i].type < JSON_LOGICAL ? NA_LOGICAL : values[i].i;
+        }
+      }
+      }
+      UNPROTECT( 1 );
+      return res;
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  // containers being parsed
+  // ---------------------------------------------------------------------------
+
+  /*
+   * An array is parsed in one of these modes, decided by its first value. When
+   * a later value doesn't fit, what's been parsed so far is converted to a LIST
+   */
+  enum array_mode { EMPTY, SCALARS, RECORDS, LIST };
+
+  struct frame {
+    bool is_array;
+    array_mode mode;
+
+    // OBJECT and LIST values
+    std::vector< SEXP > values;
+    std::vector< std::string > names;
+    std::string key;
+
+    // SCALARS
+    column scalars;
+
+    // RECORDS - one column per key, and the order of the keys in each row
+    std::vector< column > columns;
+    std::vector< int > cells;
+    std::vector< size_t > row_start;
+    bool in_record;
+    int current;
+    R_xlen_t n_rows;
+
+    frame( bool is_array, array_mode mode )
+      : is_array( is_array ), mode( mode ), in_record( false ), current( -1 ), n_rows( 0 ) {}
+
+    inline bool is_column( int i, const char* str, size_t len ) const {
+      return columns[i].name.size() == len && columns[i].name.compare( 0, len, str, len ) == 0;
+    }
+
+    /*
+     * the objects usually have their keys in the same order, so the column at
+     * the same position in the row is tried first
+     */
+    inline int find_column( const char* str, size_t len ) const {
+      int i;
+      int n = columns.size();
+      int hint = cells.size() - row_start.back();
+      if ( hint < n && is_column( hint, str, len ) ) {
+        return hint;
+      }
+      for ( i = 0; i < n; i++ ) {
+        if ( is_column( i, str, len ) ) {
+          return i;
+        }
+      }
+      return -1;
+    }
+  };
+
+  inline SEXP named_list( std::vector< SEXP >& values, std::vector< std::string >& names ) {
+    R_xlen_t i;
+    R_xlen_t n = values.size();
+    SEXP res = PROTECT( Rf_allocVector( VECSXP, n ) );
+    SEXP nms = PROTECT( Rf_allocVector( STRSXP, n ) );
+    for ( i = 0; i < n; i++ ) {
+      SET_VECTOR_ELT( res, i, values[i] );
+      SET_STRING_ELT( nms, i, Rf_mkCharLenCE( names[i].data(), static_cast< int >( names[i].size() ), CE_UTF8 ) );
+    }
+    Rf_setAttrib( res, R_NamesSymbol, nms );
+    UNPROTECT( 2 );
+    return res;
+  }
+
+  inline SEXP unnamed_list( std::vector< SEXP >& values ) {
+    R_xlen_t i;
+    R_xlen_t n = values.size();
+    SEXP res = PROTECT( Rf_allocVector( VECSXP, n ) );
+    for ( i = 0; i < n; i++ ) {
+      SET_VECTOR_ELT( res, i, values[i] );
+    }
+    UNPROTECT( 1 );
+    return res;
+  }
+
+  // ---------------------------------------------------------------------------
+  // SAX handler
+  // ---------------------------------------------------------------------------
+  class handler {
+  public:
+
+    handler( bool simplify ) : simplify( simplify ), result( R_NilValue ) {}
+
+    SEXP get_result() {
+      return result;
+    }
+
+    bool Null() {
+      scalar s;
+      s.type = JSON_NULL;
+      return add_scalar( s );
+    }
+
+    bool Bool( bool b ) {
+      scalar s;
+      s.type = JSON_LOGICAL;
+      s.i = b;
+      return add_scalar( s );
+    }
+
+    // only called without kParseNumbersAsStringsFlag
+    bool Int( int i ) { return Double( i ); }
+    bool Uint( unsigned u ) { return Double( u ); }
+    bool Int64( int64_t i ) { return Double( static_cast< double >( i ) ); }
+    bool Uint64( uint64_t u ) { return Double( static_cast< double >( u ) ); }
+    bool Double( double d ) {
+      scalar s;
+      s.type = JSON_DOUBLE;
+      s.d = d;
+      s.offset = 0;
+      s.length = 0;
+      return add_scalar( s );
+    }
+
+    bool RawNumber( const char* str, rapidjson::SizeType length, bool copy ) {
+      scalar s;
+      s.offset = arena.size();
+      s.length = length;
+      arena.append( str, length );
+
+      const char* num = arena.c_str() + s.offset;
+      if ( is_integer( str, length ) ) {
+        char* end;
+        errno = 0;
+        long l = std::strtol( num, &end, 10 );
+        if ( errno == 0 && l <= INT_MAX && l > INT_MIN ) {
+          s.type = JSON_INTEGER;
+          s.i = static_cast< int >( l );
+          return add_scalar( s );
+        }
+      }
+      s.type = JSON_DOUBLE;
+      s.d = std::strtod( num, NULL );
+      return add_scalar( s );
+    }
+
+    bool String( const char* str, rapidjson::SizeType length, bool copy ) {
+      scalar s;
+      s.type = JSON_STRING;
+      s.offset = arena.size();
+      s.length = length;
+      arena.append( str, length );
+      return add_scalar( s );
+    }
+
+    bool StartObject() {
+      if ( !stack.empty() && stack.back().is_array ) {
+        frame& f = stack.back();
+        if ( f.in_record ) {
+          record_to_object();
+        } else if ( f.mode == EMPTY || f.mode == RECORDS ) {
+          f.mode = RECORDS;
+          f.in_record = true;
+          f.current = -1;
+          f.row_start.push_back( f.cells.size() );
+          return true;
+        } else if ( f.mode == SCALARS ) {
+          scalars_to_list( f );
+        }
+      }
+      stack.push_back( frame( false, LIST ) );
+      return true;
+    }
+
+    bool Key( const char* str, rapidjson::SizeType length, bool copy ) {
+      frame& f = stack.back();
+      if ( !f.is_array ) {
+        f.key.assign( str, length );
+        return true;
+      }
+
+      int col = f.find_column( str, length );
+      if ( col < 0 ) {
+        col = f.columns.size();
+        f.columns.push_back( column() );
+        column& c = f.columns.back();
+        c.name.assign( str, length );
+        c.values.reserve( f.n_rows + 1 );
+        R_xlen_t i;
+        for ( i = 0; i < f.n_rows; i++ ) {
+          c.push_missing();
+        }
+      } else if ( static_cast< R_xlen_t >( f.columns[ col ].values.size() ) > f.n_rows ) {
+        // a duplicated key; only a list can keep both
+        record_to_object();
+        stack.back().key.assign( str, length );
+        return true;
+      }
+      f.current = col;
+      return true;
+    }
+
+    bool EndObject( rapidjson::SizeType member_count ) {
+      frame& f = stack.back();
+      if ( f.is_array ) {
+        // end of a row
+        size_t i;
+        for ( i = 0; i < f.columns.size(); i++ ) {
+          if ( static_cast< R_xlen_t >( f.columns[i].values.size() ) == f.n_rows ) {
+            f.columns[i].push_missing();
+          }
+        }
+        f.n_rows++;
+        f.in_record = false;
+        return true;
+      }
+      SEXP obj = protect.push( named_list( f.values, f.names ) );
+      stack.pop_back();
+      add_value( obj );
+      return true;
+    }
+
+    bool StartArray() {
+      if ( !stack.empty() && stack.back().is_array ) {
+        frame& f = stack.back();
+        if ( f.in_record ) {
+          record_to_object();
+        } else if ( f.mode == SCALARS ) {
+          scalars_to_list( f );
+        } else if ( f.mode == RECORDS ) {
+          records_to_list( f );
+        } else {
+          f.mode = LIST;
+        }
+      }
+      stack.push_back( frame( true, simplify ? EMPTY : LIST ) );
+      return true;
+    }
+
+    bool EndArray( rapidjson::SizeType element_count ) {
+      frame& f = stack.back();
+      SEXP arr;
+      switch( f.mode ) {
+      case SCALARS: {
+        arr = f.scalars.to_vector( arena );
+        break;
+      }
+      case RECORDS: {
+        arr = records_to_data_frame( f );
+        break;
+      }
+      default: {
+        arr = unnamed_list( f.values );
+      }
+      }
+      protect.push( arr );
+      stack.pop_back();
+      add_value( arr );
+      return true;
+    }
+
+  private:
+    bool simplify;
+    SEXP result;
+    std::string arena;
+    std::vector< frame > stack;
+    protect_stack protect;
+
+    /*
+     * an optional '-' followed by digits; anything with a fraction or
+     * exponent is a double
+     */
+    static inline bool is_integer( const char* str, rapidjson::SizeType length ) {
+      rapidjson::SizeType i;
+      for ( i = 0; i < length; i++ ) {
+        if ( str[i] == '.' || str[i] == 'e' || str[i] == 'E' ) {
+          return false;
+        }
+      }
+      // more than 10 digits can't be an int
+      return length <= 11;
+    }
+
+    /*
+     * a completed array or object
+     */
+    inline void add_value( SEXP x ) {
+      if ( stack.empty() ) {
+        result = x;
+        return;
+      }
+      frame& f = stack.back();
+      if ( !f.is_array ) {
+        f.names.push_back( f.key );
+      }
+      f.values.push_back( x );
+    }
+
+    inline bool add_scalar( const scalar& s ) {
+      if ( stack.empty() ) {
+        result = protect.push( scalar_to_sexp( arena, s ) );
+        return true;
+      }
+
+      frame& f = stack.back();
+      if ( !f.is_array ) {
+        f.names.push_back( f.key );
+        f.values.push_back( protect.push( scalar_to_sexp( arena, s ) ) );
+        return true;
+      }
+
+      if ( f.in_record ) {
+        f.cells.push_back( f.current );
+        f.columns[ f.current ].push( s );
+        return true;
+      }
+
+      switch( f.mode ) {
+      case EMPTY: {
+        f.mode = SCALARS;
+      }
+      case SCALARS: {
+        f.scalars.push( s );
+        return true;
+      }
+      case RECORDS: {
+        records_to_list( f );
+      }
+      default: {
+        f.values.push_back( protect.push( scalar_to_sexp( arena, s ) ) );
+      }
+      }
+      return true;
+    }
+
+    inline void scalars_to_list( frame& f ) {
+      size_t i;
+      f.values.reserve( f.scalars.values.size() );
+      for ( i = 0; i < f.scalars.values.size(); i++ ) {
+        f.values.push_back( protect.push( scalar_to_sexp( arena, f.scalars.values[i] ) ) );
+      }
+      f.scalars = column();
+      f.mode = LIST;
+    }
+
+    /*
+     * one row of a RECORDS array as a named list, with the keys in the order
+     * they were in the JSON
+     */
+    inline SEXP row_to_object( frame& f, R_xlen_t row, size_t start, size_t end ) {
+      size_t i;
+      std::vector< SEXP > values;
+      std::vector< std::string > names;
+      for ( i = start; i < end; i++ ) {
+        const column& c = f.columns[ f.cells[i] ];
+        names.push_back( c.name );
+        values.push_back( protect.push( scalar_to_sexp( arena, c.values[ row ] ) ) );
+      }
+      return protect.push( named_list( values, names ) );
+    }
+
+    /*
+     * the completed rows of a RECORDS array become elements of a list
+     */
+    inline void records_to_list( frame& f ) {
+      R_xlen_t row;
+      f.values.reserve( f.n_rows );
+      for ( row = 0; row < f.n_rows; row++ ) {
+        size_t end = ( row + 1 < static_cast< R_xlen_t >( f.row_start.size() ) ) ? f.row_start[ row + 1 ] : f.cells.size();
+        f.values.push_back( row_to_object( f, row, f.row_start[ row ], end ) );
+      }
+      f.columns.clear();
+      f.cells.clear();
+      f.row_start.clear();
+      f.n_rows = 0;
+      f.mode = LIST;
+    }
+
+    /*
+     * the row being parsed can't be part of a data.frame (it contains an array,
+     * an object, or a duplicated key), so it becomes an object in its own right,
+     * and the array becomes a list
+     */
+    inline void record_to_object() {
+      frame& f = stack.back();
+      size_t i;
+      size_t start = f.row_start.back();
+      R_xlen_t row = f.n_rows;
+
+      frame obj( false, LIST );
+      obj.key = f.current >= 0 ? f.columns[ f.current ].name : std::string();
+      for ( i = start; i < f.cells.size(); i++ ) {
+        const column& c = f.columns[ f.cells[i] ];
+        obj.names.push_back( c.name );
+        obj.values.push_back( protect.push( scalar_to_sexp( arena, c.values[ row ] ) ) );
+      }
+
+      f.in_record = false;
+      records_to_list( f );
+
+      stack.push_back( obj );
+    }
+
+    inline SEXP records_to_data_frame( frame& f ) {
+      R_xlen_t i;
+      R_xlen_t n_cols = f.columns.size();
+      SEXP df = PROTECT( Rf_allocVector( VECSXP, n_cols ) );
+      SEXP nms = PROTECT( Rf_allocVector( STRSXP, n_cols ) );
+      for ( i = 0; i < n_cols; i++ ) {
+        const column& c = f.columns[i];
+        SET_VECTOR_ELT( df, i, c.to_vector( arena ) );
+        SET_STRING_ELT( nms, i, Rf_mkCharLenCE( c.name.data(), static_cast< int >( c.name.size() ), CE_UTF8 ) );
+      }
+      SEXP row_names = PROTECT( Rf_allocVector( INTSXP, 2 ) );
+      INTEGER( row_names )[0] = NA_INTEGER;
+      INTEGER( row_names )[1] = -static_cast< int >( f.n_rows );
+
+      Rf_setAttrib( df, R_NamesSymbol, nms );
+      Rf_setAttrib( df, R_RowNamesSymbol, row_names );
+      Rf_setAttrib( df, R_ClassSymbol, Rf_mkString( "data.frame" ) );
+      UNPROTECT( 3 );
+      return df;
+    }
+  };
+
+  inline SEXP from_json( const char* json, bool simplify = true ) {
+    handler h( simplify );
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss( json );
+    reader.Parse< rapidjson::kParseNumbersAsStringsFlag >( ss, h );
+
+    if ( reader.HasParseError() ) {
+      Rcpp::stop(
+        "jsonify - invalid JSON at offset %d: %s",
+        static_cast< int >( reader.GetErrorOffset() ),
+        rapidjson::GetParseError_En( reader.GetParseErrorCode() )
+      );
+    }
+    return h.get_result();
+  }
+
+} // namespace from_json
+} // namespace jsonify
+
+#endif
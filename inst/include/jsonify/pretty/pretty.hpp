@@ -0,0 +1,128 @@
+#ifndef R_JSONIFY_PRETTY_H
+#define R_JSONIFY_PRETTY_H
+
+#include <Rcpp.h>
+#include "jsonify/buffers/buffers.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/reader.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/error/en.h"
+
+/*
+ * Pretty-printing and minifying pipe a rapidjson::Reader straight into a
+ * Writer (or PrettyWriter) without building a Document, so only the output
+ * is held in memory.
+ *
+ * Numbers are parsed as strings so they are written exactly as they were
+ */
+
+namespace jsonify {
+namespace pretty {
+
+  const int DEFAULT_INDENT = 4;
+
+  /*
+   * forwards the Reader's events to the writer, with raw numbers written as 
+   * raw values (Writer::RawNumber() in rapidjson 1.1.0 writes them as strings)
+   */
+  template< typename Writer >
+  struct forward_handler {
+    Writer& writer;
+
+    forward_handler( Writer& writer ) : writer( writer ) {}
+
+    bool Null() { return writer.Null(); }
+    bool Bool( bool b ) { return writer.Bool( b ); }
+    bool Int( int i ) { return writer.Int( i ); }
+    bool Uint( unsigned u ) { return writer.Uint( u ); }
+    bool Int64( int64_t i ) { return writer.Int64( i ); }
+    bool Uint64( uint64_t u ) { return writer.Uint64( u ); }
+    bool Double( double d ) { return writer.Double( d ); }
+    bool RawNumber( const char* str, rapidjson::SizeType length, bool copy ) {
+      return writer.RawValue( str, length, rapidjson::kNumberType );
+    }
+    bool String( const char* str, rapidjson::SizeType length, bool copy ) {
+      return writer.String( str, length, copy );
+    }
+    bool StartObject() { return writer.StartObject(); }
+    bool Key( const char* str, rapidjson::SizeType length, bool copy ) {
+      return writer.Key( str, length, copy );
+    }
+    bool EndObject( rapidjson::SizeType member_count ) { return writer.EndObject( member_count ); }
+    bool StartArray() { return writer.StartArray(); }
+    bool EndArray( rapidjson::SizeType element_count ) { return writer.EndArray( element_count ); }
+  };
+
+  template< typename Writer >
+  inline void transcode(
+      rapidjson::Reader& reader,
+      Writer& writer,
+      const char* json
+    ) {
+
+    forward_handler< Writer > handler( writer );
+    rapidjson::StringStream ss( json );
+    rapidjson::ParseResult ok = reader.Parse< rapidjson::kParseNumbersAsStringsFlag >( ss, handler );
+
+    if ( !ok ) {
+      Rcpp::stop(
+        "jsonify - invalid JSON at offset %d: %s",
+        static_cast< int >( ok.Offset() ),
+        rapidjson::GetParseError_En( ok.Code() )
+      );
+    }
+  }
+
+  /*
+   * transcodes each element of 'json', keeping its encoding. NA stays NA
+   */
+  template< typename Writer >
+  inline Rcpp::StringVector transcode(
+      Rcpp::StringVector& json,
+      rapidjson::Reader& reader,
+      Writer& writer,
+      rapidjson::StringBuffer& sb
+    ) {
+
+    R_xlen_t i;
+    R_xlen_t n = json.size();
+    Rcpp::StringVector res( n );
+
+    for ( i = 0; i < n; i++ ) {
+      SEXP s = STRING_ELT( json, i );
+      if ( s == NA_STRING ) {
+        SET_STRING_ELT( res, i, NA_STRING );
+        continue;
+      }
+      sb.Clear();
+      writer.Reset( sb );
+      transcode( reader, writer, CHAR( s ) );
+      SET_STRING_ELT( res, i, Rf_mkCharLenCE( sb.GetString(), sb.GetSize(), Rf_getCharCE( s ) ) );
+    }
+    res.attr("class") = "json";
+    return res;
+  }
+
+  inline Rcpp::StringVector pretty_json(
+      Rcpp::StringVector& json,
+      int indent = DEFAULT_INDENT
+    ) {
+    jsonify::buffers::lease lease;
+    rapidjson::PrettyWriter< rapidjson::StringBuffer > writer( lease.buffer() );
+    writer.SetIndent( ' ', indent );
+    return transcode( json, lease.reader(), writer, lease.buffer() );
+  }
+
+  inline Rcpp::StringVector minify_json( Rcpp::StringVector& json ) {
+    jsonify::buffers::lease lease;
+    return transcode( json, lease.reader(), lease.writer(), lease.buffer() );
+  }
+
+} // namespace pretty
+} // namespace jsonify
+
+#endif
@@ -2,28 +2,305 @@
 #define JSONIFY_API_H
 
 #include <Rcpp.h>
+#include <vector>
+#include "rapidjson/filewritestream.h"
 #include "jsonify/to_json/utils.hpp"
+#include "jsonify/buffers/buffers.hpp"
 #include "jsonify/to_json/writers/complex.hpp"
+#include "jsonify/to_json/writers/estimate.hpp"
+#include "jsonify/to_json/writers/parallel.hpp"
+#include "jsonify/to_json/ndjson/ndjson.hpp"
+#include "jsonify/to_json/stats/stats.hpp"
 
 using namespace rapidjson;
 
 namespace jsonify {
 namespace api {
 
+    /*
+     * threads - the number of threads used to write a data.frame by-row
+     */
     inline Rcpp::StringVector to_json(
             SEXP lst, 
             bool unbox = false, 
             int digits = -1, 
             bool numeric_dates = true, 
             bool factors_as_string = true, 
-            std::string by = "row") {
+            const std::string& by = "row",
+            int threads = 1) {
         
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::complex::write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by );
+        jsonify::utils::by_type orientation = jsonify::utils::to_by( by );
+        jsonify::buffers::lease lease;
+        rapidjson::StringBuffer& sb = lease.buffer();
+        
+        if ( threads > 1 && orientation == jsonify::utils::BY_ROW && Rf_inherits( lst, "data.frame" ) &&
+             jsonify::writers::parallel::write_data_frame( sb, lst, threads, digits, numeric_dates, factors_as_string ) ) {
+            return jsonify::utils::finalise_json( sb );
+        }
+        
+        sb.Reserve( jsonify::writers::estimate::size( lst, digits, numeric_dates, factors_as_string, orientation ) );
+        jsonify::writers::complex::write_value( lease.writer(), lst, unbox, digits, numeric_dates, factors_as_string, orientation );
         return jsonify::utils::finalise_json( sb );
     }
 
+    /*
+     * to_json() of the selected rows and columns of a data.frame or matrix,
+     * written straight from the object without copying the subset. 
+     * 
+     * rows, cols - 1-based indices, or NULL to select all of them
+     */
+    inline Rcpp::StringVector to_json_subset(
+            SEXP x,
+            SEXP rows,
+            SEXP cols,
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        jsonify::utils::by_type orientation = jsonify::utils::to_by( by );
+        bool is_matrix = Rf_isMatrix( x );
+        int n_rows;
+        int n_cols;
+        
+        if ( is_matrix ) {
+            n_rows = Rf_nrows( x );
+            n_cols = Rf_ncols( x );
+        } else if ( Rf_inherits( x, "data.frame" ) ) {
+            n_rows = jsonify::utils::data_frame_rows( x );
+            n_cols = Rf_length( x );
+        } else {
+            Rcpp::stop("jsonify - rows and cols can only be used with a data.frame or matrix");
+        }
+        
+        std::vector< int > row_index;
+        std::vector< int > col_index;
+        jsonify::utils::selection selected_rows = jsonify::utils::select( rows, n_rows, row_index, "rows" );
+        jsonify::utils::selection selected_cols = jsonify::utils::select( cols, n_cols, col_index, "columns" );
+        
+        // the estimate is for the whole object, so it's scaled to the subset
+        double size = static_cast< double >( 
+          jsonify::writers::estimate::size( x, digits, numeric_dates, factors_as_string, orientation ) 
+        );
+        size *= n_rows == 0 ? 0 : static_cast< double >( selected_rows.size() ) / n_rows;
+        size *= n_cols == 0 ? 0 : static_cast< double >( selected_cols.size() ) / n_cols;
+        
+        jsonify::buffers::lease lease;
+        rapidjson::StringBuffer& sb = lease.buffer();
+        sb.Reserve( static_cast< size_t >( size ) );
+        
+        if ( is_matrix ) {
+            jsonify::writers::simple::write_value( 
+              lease.writer(), x, selected_rows, selected_cols, unbox, digits, orientation 
+            );
+        } else {
+            jsonify::writers::complex::write_data_frame( 
+              lease.writer(), x, selected_rows, selected_cols, unbox, digits, numeric_dates, factors_as_string, orientation 
+            );
+        }
+        return jsonify::utils::finalise_json( sb );
+    }
+
+    /*
+     * to_json() with an instrumented writer, returning the JSON along with
+     * counts of the values written and the time spent in each section
+     */
+    inline Rcpp::List to_json_stats(
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        jsonify::utils::by_type orientation = jsonify::utils::to_by( by );
+        jsonify::stats::counters stats;
+        jsonify::stats::counting_allocator allocator;
+        allocator.stats = &stats;
+        
+        jsonify::stats::clock::time_point start = jsonify::stats::clock::now();
+        
+        jsonify::stats::buffer sb( &allocator );
+        sb.Reserve( jsonify::writers::estimate::size( lst, digits, numeric_dates, factors_as_string, orientation ) );
+        jsonify::stats::stats_writer< jsonify::stats::buffer > writer( sb, stats );
+        jsonify::writers::complex::write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, orientation );
+        
+        double total = std::chrono::duration< double >( jsonify::stats::clock::now() - start ).count();
+        
+        Rcpp::StringVector js = jsonify::utils::finalise_json( sb );
+        
+        Rcpp::NumericVector counts = Rcpp::NumericVector::create(
+            Rcpp::_["name"] = stats.names,
+            Rcpp::_["string"] = stats.strings,
+            Rcpp::_["double"] = stats.numbers,
+            Rcpp::_["integer"] = stats.integers,
+            Rcpp::_["logical"] = stats.logicals,
+            Rcpp::_["null"] = stats.nulls,
+            Rcpp::_["object"] = stats.objects,
+            Rcpp::_["array"] = stats.arrays
+        );
+        
+        Rcpp::NumericVector seconds = Rcpp::NumericVector::create(
+            Rcpp::_["total"] = total,
+            Rcpp::_["dates"] = stats.seconds[ jsonify::stats::DATES ],
+            Rcpp::_["factors"] = stats.seconds[ jsonify::stats::FACTORS ],
+            Rcpp::_["strings"] = stats.seconds[ jsonify::stats::STRINGS ],
+            Rcpp::_["buffer"] = stats.seconds[ jsonify::stats::BUFFER ]
+        );
+        
+        return Rcpp::List::create(
+            Rcpp::_["json"] = js,
+            Rcpp::_["bytes"] = static_cast< double >( sb.GetSize() ),
+            Rcpp::_["counts"] = counts,
+            Rcpp::_["seconds"] = seconds,
+            Rcpp::_["buffer_growths"] = stats.buffer_growths
+        );
+    }
+
+    /*
+     * converts each element of a list to JSON, reusing the same buffer and writer
+     * returns a character vector, with the list's names
+     */
+    inline Rcpp::StringVector to_json_each(
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        if ( TYPEOF( lst ) != VECSXP ) {
+            Rcpp::stop("jsonify - expecting a list");
+        }
+        
+        R_xlen_t i;
+        R_xlen_t n = Rf_xlength( lst );
+        Rcpp::StringVector res( n );
+        jsonify::utils::by_type orientation = jsonify::utils::to_by( by );
+        
+        jsonify::buffers::lease lease;
+        rapidjson::StringBuffer& sb = lease.buffer();
+        rapidjson::Writer < rapidjson::StringBuffer >& writer = lease.writer();
+        
+        for ( i = 0; i < n; i++ ) {
+            sb.Clear();
+            writer.Reset( sb );
+            jsonify::writers::complex::write_value( writer, VECTOR_ELT( lst, i ), unbox, digits, numeric_dates, factors_as_string, orientation );
+            SET_STRING_ELT( res, i, Rf_mkCharLen( sb.GetString(), sb.GetSize() ) );
+        }
+        
+        SEXP names = Rf_getAttrib( lst, R_NamesSymbol );
+        if ( !Rf_isNull( names ) ) {
+            res.attr("names") = names;
+        }
+        res.attr("class") = "json";
+        return res;
+    }
+
+    /*
+     * writes the JSON to any rapidjson output stream (e.g. FileWriteStream)
+     * rather than holding it in memory
+     */
+    template< typename OutputStream >
+    inline void to_json_stream(
+            OutputStream& os,
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        rapidjson::Writer < OutputStream > writer( os );
+        jsonify::writers::complex::write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, jsonify::utils::to_by( by ) );
+        os.Flush();
+    }
+
+    inline void to_json_file(
+            const char* path,
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        jsonify::utils::output_file file( path );
+        std::vector< char > buffer( jsonify::utils::FILE_BUFFER_SIZE );
+        rapidjson::FileWriteStream os( file.fp, &buffer[0], buffer.size() );
+        to_json_stream( os, lst, unbox, digits, numeric_dates, factors_as_string, by );
+        file.close();
+    }
+
+    /*
+     * newline-delimited JSON; each row of a data.frame, or element of a list, 
+     * is a separate JSON document
+     * 
+     * as_vector - if true, returns a character vector with one element per 
+     * record, otherwise a single string with records separated by newlines
+     */
+    inline Rcpp::StringVector to_ndjson(
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row",
+            bool as_vector = false) {
+        
+        jsonify::utils::by_type orientation = jsonify::utils::to_by( by );
+        jsonify::buffers::lease lease;
+        rapidjson::StringBuffer& sb = lease.buffer();
+        rapidjson::Writer < rapidjson::StringBuffer >& writer = lease.writer();
+        
+        if ( as_vector ) {
+            jsonify::ndjson::vector_records records( sb, jsonify::writers::complex::n_records( lst ) );
+            jsonify::writers::complex::write_records( writer, records, lst, unbox, digits, numeric_dates, factors_as_string, orientation );
+            records.res.attr("class") = "json";
+            return records.res;
+        }
+        
+        sb.Reserve( jsonify::writers::estimate::size( lst, digits, numeric_dates, factors_as_string, orientation ) );
+        jsonify::ndjson::string_records records( sb );
+        jsonify::writers::complex::write_records( writer, records, lst, unbox, digits, numeric_dates, factors_as_string, orientation );
+        Rcpp::StringVector js = jsonify::utils::finalise_json( sb );
+        js.attr("class") = "ndjson";
+        return js;
+    }
+
+    template< typename OutputStream >
+    inline void to_ndjson_stream(
+            OutputStream& os,
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        rapidjson::Writer < OutputStream > writer( os );
+        jsonify::ndjson::stream_records< OutputStream > records( os );
+        jsonify::writers::complex::write_records( writer, records, lst, unbox, digits, numeric_dates, factors_as_string, jsonify::utils::to_by( by ) );
+        os.Flush();
+    }
+
+    inline void to_ndjson_file(
+            const char* path,
+            SEXP lst, 
+            bool unbox = false, 
+            int digits = -1, 
+            bool numeric_dates = true, 
+            bool factors_as_string = true, 
+            const std::string& by = "row") {
+        
+        jsonify::utils::output_file file( path );
+        std::vector< char > buffer( jsonify::utils::FILE_BUFFER_SIZE );
+        rapidjson::FileWriteStream os( file.fp, &buffer[0], buffer.size() );
+        to_ndjson_stream( os, lst, unbox, digits, numeric_dates, factors_as_string, by );
+        file.close();
+    }
+
 } // namespace api
 } // namespace jsonify
 
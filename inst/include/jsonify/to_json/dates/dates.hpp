@@ -2,105 +2,167 @@
 #define JSONIFY_DATES_H
 
 #include <Rcpp.h>
-#include <boost/date_time.hpp>
+#include <cmath>
 
-// [[Rcpp::depends(BH)]]
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "jsonify/to_json/stats/timer.hpp"
 
 namespace jsonify {
 namespace dates {
 
-  inline bool is_in( const char* x, Rcpp::CharacterVector v ) {
-    int n = v.size();
+  // ---------------------------------------------------------------------------
+  // ISO-8601 formatting
+  // ---------------------------------------------------------------------------
+
+  // enough for a quoted "-YYYYYYYYYYYYYYYY-MM-DDTHH:MM:SS"
+  const int DATE_BUFFER_SIZE = 64;
+
+  /*
+   * Dates and POSIXct values at least this far from the epoch (2^53, beyond 
+   * which a double can't hold every whole day or second) are written as null, 
+   * as R formats them as NA. It also keeps the conversion to long long, and 
+   * the civil date arithmetic, in range
+   */
+  const double MAX_DATE_VALUE = 9007199254740992.0;
+
+  inline bool is_date_value( double value ) {
+    return R_FINITE( value ) && std::fabs( value ) < MAX_DATE_VALUE;
+  }
+
+  /*
+   * days since 1970-01-01 to a (proleptic Gregorian) civil date
+   * http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+   */
+  inline void civil_from_days( long long z, long long& y, int& m, int& d ) {
+    z += 719468;
+    long long era = ( z >= 0 ? z : z - 146096 ) / 146097;
+    long long doe = z - era * 146097;                                     // [0, 146096]
+    long long yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;  // [0, 399]
+    long long doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );            // [0, 365]
+    long long mp = ( 5 * doy + 2 ) / 153;                                 // [0, 11]
+    d = static_cast< int >( doy - ( 153 * mp + 2 ) / 5 + 1 );
+    m = static_cast< int >( mp < 10 ? mp + 3 : mp - 9 );
+    y = yoe + era * 400 + ( m <= 2 );
+  }
+
+  inline char* write_digits( char* buf, long long value, int width ) {
     int i;
-    for( i = 0; i < n; i++ ) {
-      if( v[i] == x ) {
-        return true;
-      }
+    for ( i = width - 1; i >= 0; i-- ) {
+      buf[i] = static_cast< char >( '0' + ( value % 10 ) );
+      value /= 10;
     }
-    return false;
+    return buf + width;
   }
 
-  inline Rcpp::StringVector date_to_string( Rcpp::IntegerVector& iv ) {
-    
-    int i;
-    int n = iv.size();
-    Rcpp::StringVector sv( n );
-    
-    for ( i = 0; i < n; i++ ) {
-      Rcpp::Date d = iv[i];
-      boost::gregorian::date gd = boost::gregorian::date(d.getYear(), d.getMonth(), d.getDay());
-      std::string s = boost::gregorian::to_iso_extended_string( gd );
-      sv[i] = s.c_str();
+  inline char* write_year( char* buf, long long year ) {
+    if ( year < 0 ) {
+      *buf++ = '-';
+      year = -year;
     }
-    return sv;
+    int width = 4;
+    long long y;
+    for ( y = year / 10000; y > 0; y /= 10 ) {
+      width++;
+    }
+    return write_digits( buf, year, width );
   }
 
-  inline Rcpp::StringVector date_to_string( Rcpp::NumericVector& nv ) {
-    
-    int i;
-    int n = nv.size();
-    Rcpp::StringVector sv( n );
-    
-    for ( i = 0; i < n; i++ ) {
-      Rcpp::Date d = nv[i];
-      boost::gregorian::date gd = boost::gregorian::date(d.getYear(), d.getMonth(), d.getDay());
-      std::string s = boost::gregorian::to_iso_extended_string( gd );
-      sv[i] = s.c_str();
+  inline char* write_ymd( char* buf, long long days ) {
+    long long y;
+    int m, d;
+    civil_from_days( days, y, m, d );
+    buf = write_year( buf, y );
+    *buf++ = '-';
+    buf = write_digits( buf, m, 2 );
+    *buf++ = '-';
+    return write_digits( buf, d, 2 );
+  }
+
+  /*
+   * formats a Date (days since epoch) as YYYY-MM-DD
+   * 'value' must be an is_date_value()
+   * returns the number of characters written
+   */
+  inline int format_date( char* buf, double value ) {
+    char* end = write_ymd( buf, static_cast< long long >( std::floor( value ) ) );
+    return static_cast< int >( end - buf );
+  }
+
+  /*
+   * formats a POSIXct (seconds since epoch, UTC) as YYYY-MM-DDTHH:MM:SS
+   * 'value' must be an is_date_value()
+   * returns the number of characters written
+   */
+  inline int format_posixct( char* buf, double value ) {
+
+    long long t = static_cast< long long >( std::floor( value ) );
+    long long days = ( t >= 0 ? t : t - 86399 ) / 86400;
+    long long sod = t - days * 86400;
+
+    char* p = write_ymd( buf, days );
+    *p++ = 'T';
+    p = write_digits( p, sod / 3600, 2 );
+    *p++ = ':';
+    p = write_digits( p, ( sod % 3600 ) / 60, 2 );
+    *p++ = ':';
+    p = write_digits( p, sod % 60, 2 );
+    return static_cast< int >( p - buf );
+  }
+
+  // ---------------------------------------------------------------------------
+  // writers
+  // the formatted dates never need escaping, so they go straight into the output
+  // ---------------------------------------------------------------------------
+  template< typename Writer >
+  inline void write_date( Writer& writer, double value ) {
+    jsonify::stats::timer< Writer > t( writer, jsonify::stats::DATES );
+    if ( !is_date_value( value ) ) {
+      writer.Null();
+      return;
     }
-    return sv;
+    char buf[ DATE_BUFFER_SIZE ];
+    buf[0] = '"';
+    int n = format_date( buf + 1, value );
+    buf[ n + 1 ] = '"';
+    writer.RawValue( buf, n + 2, rapidjson::kStringType );
   }
 
-  inline Rcpp::StringVector posixct_to_string( Rcpp::IntegerVector& iv ) {
-    
-    int i;
-    int n = iv.size();
-
-    Rcpp::StringVector sv( n );
-    
-    for ( i = 0; i < n; i++ ) {
-      Rcpp::Datetime d = iv[i];
-      boost::gregorian::date dt( d.getYear(), d.getMonth(), d.getDay() );
-      boost::posix_time::hours h( d.getHours() );
-      boost::posix_time::minutes mins( d.getMinutes() );
-      boost::posix_time::seconds sec( d.getSeconds() );
-      boost::posix_time::time_duration td = h + mins + sec;
-      
-      boost::posix_time::ptime pt = boost::posix_time::ptime( dt, td );
-      
-      std::string s = boost::posix_time::to_iso_extended_string( pt );
-      sv[i] = s.c_str();
+  template< typename Writer >
+  inline void write_posixct( Writer& writer, double value ) {
+    jsonify::stats::timer< Writer > t( writer, jsonify::stats::DATES );
+    if ( !is_date_value( value ) ) {
+      writer.Null();
+      return;
     }
-    return sv;
+    char buf[ DATE_BUFFER_SIZE ];
+    buf[0] = '"';
+    int n = format_posixct( buf + 1, value );
+    buf[ n + 1 ] = '"';
+    writer.RawValue( buf, n + 2, rapidjson::kStringType );
   }
-  
-  inline Rcpp::StringVector posixct_to_string( Rcpp::NumericVector& nv ) {
-    
-    int i;
-    int n = nv.size();
-    
-    boost::local_time::tz_database tz_db;
-    
-    Rcpp::StringVector sv( n );
-    
-    for ( i = 0; i < n; i++ ) {
-      Rcpp::Datetime d = nv[i];
-      boost::gregorian::date dt( d.getYear(), d.getMonth(), d.getDay() );
-      boost::posix_time::hours h( d.getHours() );
-      boost::posix_time::minutes mins( d.getMinutes() );
-      boost::posix_time::seconds sec( d.getSeconds() );
-      boost::posix_time::time_duration td = h + mins + sec;
-      
-      boost::posix_time::ptime pt = boost::posix_time::ptime( dt, td );
-      
-      std::string s = boost::posix_time::to_iso_extended_string( pt );
-      sv[i] = s.c_str();
+
+  template< typename Writer >
+  inline void write_date( Writer& writer, int value ) {
+    if ( value == NA_INTEGER ) {
+      writer.Null();
+    } else {
+      write_date( writer, static_cast< double >( value ) );
     }
-    return sv;
   }
 
+  template< typename Writer >
+  inline void write_posixct( Writer& writer, int value ) {
+    if ( value == NA_INTEGER ) {
+      writer.Null();
+    } else {
+      write_posixct( writer, static_cast< double >( value ) );
+    }
+  }
 
-} // namespace format
+} // namespace dates
 } // namespace jsonify
 
 
-#endif 
+#endif
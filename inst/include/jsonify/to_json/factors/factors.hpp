@@ -0,0 +1,99 @@
+#ifndef JSONIFY_FACTORS_H
+#define JSONIFY_FACTORS_H
+
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "jsonify/to_json/stats/timer.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+
+namespace jsonify {
+namespace factors {
+
+  /*
+   * The levels of a factor, each escaped and quoted once, so the factor's
+   * values can be written by copying the JSON of their level without creating
+   * a character vector.
+   */
+  class levels {
+  public:
+
+    levels( SEXP lvls ) {
+      R_xlen_t i;
+      R_xlen_t n = Rf_isNull( lvls ) ? 0 : Rf_xlength( lvls );
+
+      rapidjson::StringBuffer sb;
+      rapidjson::Writer< rapidjson::StringBuffer > writer( sb );
+
+      offsets.reserve( n + 1 );
+      is_na.reserve( n );
+
+      for ( i = 0; i < n; i++ ) {
+        offsets.push_back( json.size() );
+        SEXP s = STRING_ELT( lvls, i );
+        is_na.push_back( s == NA_STRING );
+        if ( s != NA_STRING ) {
+          sb.Clear();
+          writer.Reset( sb );
+          writer.String( CHAR( s ), LENGTH( s ) );
+          json.append( sb.GetString(), sb.GetSize() );
+        }
+      }
+      offsets.push_back( json.size() );
+    }
+
+    R_xlen_t size() const {
+      return is_na.size();
+    }
+
+    /*
+     * code - the 1-based integer value of the factor
+     */
+    template< typename Writer >
+    inline void write( Writer& writer, int code ) const {
+      jsonify::stats::timer< Writer > t( writer, jsonify::stats::FACTORS );
+      if ( code == NA_INTEGER || is_na[ code - 1 ] ) {
+        writer.Null();
+      } else {
+        writer.RawValue(
+          json.data() + offsets[ code - 1 ],
+          offsets[ code ] - offsets[ code - 1 ],
+          rapidjson::kStringType
+        );
+      }
+    }
+
+  private:
+    std::string json;
+    std::vector< size_t > offsets;
+    std::vector< bool > is_na;
+  };
+
+  /*
+   * writes a single value of a factor without caching its levels, for when
+   * only one row is needed
+   */
+  template< typename Writer >
+  inline void write_value( Writer& writer, SEXP lvls, int code ) {
+    jsonify::stats::timer< Writer > t( writer, jsonify::stats::FACTORS );
+    if ( code == NA_INTEGER ) {
+      writer.Null();
+      return;
+    }
+    SEXP s = STRING_ELT( lvls, code - 1 );
+    if ( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      jsonify::writers::scalars::write_string( writer, s );
+    }
+  }
+
+} // namespace factors
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef JSONIFY_NDJSON_H
+#define JSONIFY_NDJSON_H
+
+#include <Rcpp.h>
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+/*
+ * Record handlers for jsonify::writers::complex::write_records(), which write
+ * newline-delimited JSON (http://ndjson.org)
+ */
+
+namespace jsonify {
+namespace ndjson {
+
+  /*
+   * records are written to the output stream, each followed by a newline
+   */
+  template< typename OutputStream >
+  struct stream_records {
+    OutputStream& os;
+
+    stream_records( OutputStream& os ) : os( os ) {}
+
+    template< typename Writer >
+    void start( Writer& writer, int i ) {
+      writer.Reset( os );
+    }
+
+    template< typename Writer >
+    void end( Writer& writer, int i ) {
+      os.Put('\n');
+    }
+  };
+
+  /*
+   * records are written to a single string, separated by newlines
+   */
+  struct string_records {
+    rapidjson::StringBuffer& sb;
+
+    string_records( rapidjson::StringBuffer& sb ) : sb( sb ) {}
+
+    template< typename Writer >
+    void start( Writer& writer, int i ) {
+      if ( i > 0 ) {
+        sb.Put('\n');
+      }
+      writer.Reset( sb );
+    }
+
+    template< typename Writer >
+    void end( Writer& writer, int i ) {}
+  };
+
+  /*
+   * each record is a separate element of a character vector
+   */
+  struct vector_records {
+    rapidjson::StringBuffer& sb;
+    Rcpp::StringVector res;
+
+    vector_records( rapidjson::StringBuffer& sb, int n ) : sb( sb ), res( n ) {}
+
+    template< typename Writer >
+    void start( Writer& writer, int i ) {
+      sb.Clear();
+      writer.Reset( sb );
+    }
+
+    template< typename Writer >
+    void end( Writer& writer, int i ) {
+      SET_STRING_ELT( res, i, Rf_mkCharLen( sb.GetString(), sb.GetSize() ) );
+    }
+  };
+
+} // namespace ndjson
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef R_JSONIFY_STATS_H
+#define R_JSONIFY_STATS_H
+
+#include <Rcpp.h>
+#include <chrono>
+#include <cstring>
+#include "jsonify/to_json/stats/timer.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+/*
+ * Instrumentation for to_json(). The writers are templated on the Writer, so
+ * using stats_writer instead of rapidjson::Writer is a compile-time policy;
+ * the normal writer pays nothing for it.
+ */
+
+namespace jsonify {
+namespace stats {
+
+  typedef std::chrono::steady_clock clock;
+
+  struct counters {
+    double names;
+    double strings;
+    double numbers;
+    double integers;
+    double logicals;
+    double nulls;
+    double objects;
+    double arrays;
+    double buffer_growths;
+    double seconds[ N_SECTIONS ];
+
+    counters() : names( 0 ), strings( 0 ), numbers( 0 ), integers( 0 ), logicals( 0 ), nulls( 0 ),
+      objects( 0 ), arrays( 0 ), buffer_growths( 0 ) {
+      int i;
+      for ( i = 0; i < N_SECTIONS; i++ ) {
+        seconds[i] = 0;
+      }
+    }
+  };
+
+  struct section_timer {
+    counters& stats;
+    section s;
+    clock::time_point start;
+
+    section_timer( counters& stats, section s ) : stats( stats ), s( s ), start( clock::now() ) {}
+
+    ~section_timer() {
+      stats.seconds[ s ] += std::chrono::duration< double >( clock::now() - start ).count();
+    }
+  };
+
+  /*
+   * An allocator for the output buffer which counts, and times, each time 
+   * the buffer grows. The first allocation (of the size reserved from the
+   * estimate) isn't a growth, so only reallocations of an existing buffer
+   * are counted
+   */
+  class counting_allocator {
+  public:
+    static const bool kNeedFree = true;
+
+    counting_allocator() : stats( NULL ) {}
+
+    void* Malloc( size_t size ) {
+      return base.Malloc( size );
+    }
+
+    void* Realloc( void* ptr, size_t original_size, size_t new_size ) {
+      if ( stats == NULL || ptr == NULL ) {
+        return base.Realloc( ptr, original_size, new_size );
+      }
+      section_timer t( *stats, BUFFER );
+      stats -> buffer_growths++;
+      return base.Realloc( ptr, original_size, new_size );
+    }
+
+    static void Free( void* ptr ) {
+      rapidjson::CrtAllocator::Free( ptr );
+    }
+
+    counters* stats;
+
+  private:
+    rapidjson::CrtAllocator base;
+  };
+
+  typedef rapidjson::GenericStringBuffer< rapidjson::UTF8<>, counting_allocator > buffer;
+
+  /*
+   * A Writer which counts the values written, and times string escaping
+   */
+  template< typename OutputStream >
+  class stats_writer : public rapidjson::Writer< OutputStream > {
+    typedef rapidjson::Writer< OutputStream > Base;
+
+  public:
+    counters& stats;
+
+    stats_writer( OutputStream& os, counters& stats ) : Base( os ), stats( stats ) {}
+
+    bool Null() { stats.nulls++; return Base::Null(); }
+    bool Bool( bool b ) { stats.logicals++; return Base::Bool( b ); }
+    bool Int( int i ) { stats.integers++; return Base::Int( i ); }
+    bool Uint( unsigned u ) { stats.integers++; return Base::Uint( u ); }
+    bool Int64( int64_t i ) { stats.integers++; return Base::Int64( i ); }
+    bool Uint64( uint64_t u ) { stats.integers++; return Base::Uint64( u ); }
+    bool Double( double d ) { stats.numbers++; return Base::Double( d ); }
+
+    bool String( const char* str, rapidjson::SizeType length, bool copy = false ) {
+      if ( is_name() ) {
+        stats.names++;
+      } else {
+        stats.strings++;
+      }
+      section_timer t( stats, STRINGS );
+      return Base::String( str, length, copy );
+    }
+
+    bool String( const char* str ) {
+      return String( str, static_cast< rapidjson::SizeType >( std::strlen( str ) ) );
+    }
+
+    bool StartObject() { stats.objects++; return Base::StartObject(); }
+    bool StartArray() { stats.arrays++; return Base::StartArray(); }
+
+    // names copied from a data.frame's plan are raw strings too
+    bool RawValue( const char* json, size_t length, rapidjson::Type type ) {
+      if ( type == rapidjson::kStringType && is_name() ) {
+        stats.names++;
+      } else if ( type == rapidjson::kStringType ) {
+        stats.strings++;
+      } else if ( type == rapidjson::kNumberType ) {
+        stats.numbers++;
+      }
+      return Base::RawValue( json, length, type );
+    }
+
+  private:
+    // a string in an object after an even number of values is a name
+    bool is_name() {
+      if ( Base::level_stack_.Empty() ) {
+        return false;
+      }
+      typename Base::Level* level = Base::level_stack_.template Top< typename Base::Level >();
+      return !level -> inArray && level -> valueCount % 2 == 0;
+    }
+  };
+
+  template< typename OutputStream >
+  struct timer< stats_writer< OutputStream > > {
+    section_timer t;
+    timer( stats_writer< OutputStream >& writer, section s ) : t( writer.stats, s ) {}
+  };
+
+} // namespace stats
+
+namespace writers {
+namespace scalars {
+
+  // a string without escapes is counted, then written as rapidjson::Writer 
+  // writes it. Any other is counted and timed by stats_writer::String()
+  template< typename OutputStream >
+  struct plain_string< jsonify::stats::stats_writer< OutputStream >, false > {
+    static void write( jsonify::stats::stats_writer< OutputStream >& writer, const char* value, size_t length ) {
+      if ( jsonify::writers::escape::needs_escaping( value, length ) ) {
+        writer.String( value, static_cast< rapidjson::SizeType >( length ) );
+      } else {
+        writer.stats.strings++;
+        plain_string< rapidjson::Writer< OutputStream > >::put( writer, value, length );
+      }
+    }
+  };
+
+} // namespace scalars
+} // namespace writers
+} // namespace jsonify
+
+#endif
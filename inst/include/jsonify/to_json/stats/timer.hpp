@@ -0,0 +1,21 @@
+#ifndef R_JSONIFY_STATS_TIMER_H
+#define R_JSONIFY_STATS_TIMER_H
+
+namespace jsonify {
+namespace stats {
+
+  enum section { DATES = 0, FACTORS, STRINGS, BUFFER, N_SECTIONS };
+
+  /*
+   * Times a section of the writers. It does nothing, and costs nothing, unless
+   * it's specialised for an instrumented writer (see stats.hpp)
+   */
+  template< typename Writer >
+  struct timer {
+    timer( Writer& writer, section s ) {}
+  };
+
+} // namespace stats
+} // namespace jsonify
+
+#endif
@@ -2,6 +2,11 @@
 #define R_JSONIFY_WRITERS_UTILS_H
 
 #include <Rcpp.h>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 // [[Rcpp::depends(rapidjsonr)]]
 
@@ -31,15 +36,151 @@ namespace utils {
   }
 
 
-  inline Rcpp::StringVector finalise_json( rapidjson::StringBuffer& sb ) {
-    Rcpp::StringVector js = sb.GetString();
+  const size_t FILE_BUFFER_SIZE = 65536;
+
+  /*
+   * a file opened for writing, which is closed if an error is thrown while writing
+   */
+  class output_file {
+  public:
+    std::FILE* fp;
+
+    output_file( const char* path ) {
+      fp = std::fopen( R_ExpandFileName( path ), "wb" );
+      if ( fp == NULL ) {
+        Rcpp::stop("jsonify - unable to open file for writing");
+      }
+    }
+
+    ~output_file() {
+      if ( fp != NULL ) {
+        std::fclose( fp );
+      }
+    }
+
+    void close() {
+      bool failed = std::ferror( fp ) != 0;
+      failed = ( std::fclose( fp ) != 0 ) || failed;
+      fp = NULL;
+      if ( failed ) {
+        Rcpp::stop("jsonify - error writing to file");
+      }
+    }
+  };
+
+  /*
+   * copies the buffer into an R string, using its size rather than searching
+   * for the terminating null
+   */
+  template< typename Buffer >
+  inline Rcpp::StringVector finalise_json( Buffer& sb ) {
+    if ( sb.GetSize() > static_cast< size_t >( INT_MAX ) ) {
+      Rcpp::stop("jsonify - the JSON is too large to return as a string, try to_json_file()");
+    }
+    Rcpp::StringVector js( 1 );
+    SET_STRING_ELT( js, 0, Rf_mkCharLenCE( sb.GetString(), static_cast< int >( sb.GetSize() ), CE_NATIVE ) );
     js.attr("class") = "json";
     return js;
   }
 
+  /*
+   * whether data.frames and matrices are written by-row or by-column. The 
+   * "row" / "column" argument is converted once, rather than being copied 
+   * and compared on every recursion
+   */
+  enum by_type { BY_ROW = 0, BY_COLUMN };
+
+  inline by_type to_by( const std::string& by ) {
+    return by == "column" ? BY_COLUMN : BY_ROW;
+  }
+
+  /*
+   * the number of rows of a data.frame, read from its row names without 
+   * converting it or expanding compact row names ( c(NA, -n) )
+   */
+  inline int data_frame_rows( SEXP df ) {
+    SEXP att;
+    for ( att = ATTRIB( df ); att != R_NilValue; att = CDR( att ) ) {
+      if ( TAG( att ) == R_RowNamesSymbol ) {
+        SEXP rn = CAR( att );
+        if ( TYPEOF( rn ) == INTSXP && LENGTH( rn ) == 2 && INTEGER( rn )[0] == NA_INTEGER ) {
+          return std::abs( INTEGER( rn )[1] );
+        }
+        return LENGTH( rn );
+      }
+    }
+    return 0;
+  }
+
+  /*
+   * the rows (or columns) of a data.frame or matrix to write. Either all 'n' 
+   * of them, or the 0-based indices in 'idx', so a subset is written straight 
+   * from the object rather than from a copy of it
+   */
+  struct selection {
+    const int* idx;
+    int n;
+
+    int size() const {
+      return n;
+    }
+
+    int operator[]( int i ) const {
+      return idx == NULL ? i : idx[i];
+    }
+  };
+
+  inline selection select_all( int n ) {
+    selection s;
+    s.idx = NULL;
+    s.n = n;
+    return s;
+  }
+
+  /*
+   * 'index' - 1-based R indices (integer, or numeric which is truncated like
+   * R's '['), converted to 0-based. NULL selects all 'n'
+   */
+  inline selection select( SEXP index, int n, std::vector< int >& idx, const char* what ) {
+    if ( Rf_isNull( index ) ) {
+      return select_all( n );
+    }
+    if ( TYPEOF( index ) != INTSXP && TYPEOF( index ) != REALSXP ) {
+      Rcpp::stop( std::string( "jsonify - " ) + what + " must be an integer or numeric index" );
+    }
+    R_xlen_t i;
+    Rcpp::IntegerVector iv( index );    // coerces (and protects) a numeric index
+    R_xlen_t n_index = Rf_xlength( iv );
+    const int* p = INTEGER( iv );
+    idx.resize( n_index );
+    for ( i = 0; i < n_index; i++ ) {
+      if ( p[i] == NA_INTEGER || p[i] < 1 || p[i] > n ) {
+        Rcpp::stop( std::string( "jsonify - " ) + what + " must be between 1 and the number of " + what );
+      }
+      idx[i] = p[i] - 1;
+    }
+    selection s;
+    s.idx = idx.data();
+    s.n = static_cast< int >( n_index );
+    return s;
+  }
+
+  /*
+   * a character vector of JSON which has already been written, e.g. by
+   * to_json() or as.json()
+   */
+  inline bool is_json( SEXP x ) {
+    return TYPEOF( x ) == STRSXP && Rf_inherits( x, "json" );
+  }
+
   inline bool should_unbox( int n, bool unbox ) {
     return ( unbox && n == 1 );
   }
+
+  // a single json document is always embedded as it is
+  inline bool should_unbox_json( R_xlen_t n ) {
+    return n == 1;
+  }
   
   template< typename Writer >
   inline void writer_starter( Writer& writer, bool& has_names ) {
@@ -2,9 +2,12 @@
 #define R_JSONIFY_WRITERS_COMPLEX_H
 
 #include <Rcpp.h>
+#include <cstdio>
+#include <string>
 #include "jsonify/to_json/utils.hpp"
 #include "jsonify/to_json/dates/dates.hpp"
 #include "jsonify/to_json/writers/simple.hpp"
+#include "jsonify/to_json/writers/plan.hpp"
 #include <math.h>
 
 using namespace rapidjson;
@@ -23,6 +26,11 @@ namespace complex {
       bool factors_as_string
     ) {
     
+    if ( jsonify::utils::is_json( this_vec ) ) {
+      jsonify::writers::simple::write_json( writer, this_vec );
+      return;
+    }
+    
     switch( TYPEOF( this_vec ) ) {
     case REALSXP: {
       Rcpp::NumericVector nv = Rcpp::as< Rcpp::NumericVector >( this_vec );
@@ -31,22 +39,7 @@ namespace complex {
     }
     case INTSXP: {
       Rcpp::IntegerVector iv = Rcpp::as< Rcpp::IntegerVector >( this_vec );
-      if ( factors_as_string && Rf_isFactor( this_vec ) ) {
-        Rcpp::CharacterVector lvls = iv.attr( "levels" );
-        if( lvls.length() == 0 ) {
-          // no levels - from NA_character_ vector
-          
-          Rcpp::StringVector s(1);
-          s[0] = NA_STRING;
-          int ele = 0;
-          jsonify::writers::simple::write_value( writer, s, ele );
-        } else {
-          Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-          jsonify::writers::simple::write_value( writer, str, unbox );
-        }
-      } else {
-        jsonify::writers::simple::write_value( writer, iv, unbox, numeric_dates, factors_as_string );
-      }
+      jsonify::writers::simple::write_value( writer, iv, unbox, numeric_dates, factors_as_string );
       break;
     }
     case LGLSXP: {
@@ -74,6 +67,11 @@ namespace complex {
       int row
     ) {
     
+    if ( jsonify::utils::is_json( this_vec ) ) {
+      jsonify::writers::simple::write_json( writer, this_vec, row );
+      return;
+    }
+    
     switch( TYPEOF( this_vec ) ) {
     case REALSXP: {
       Rcpp::NumericVector nv = Rcpp::as< Rcpp::NumericVector >( this_vec );
@@ -82,24 +80,7 @@ namespace complex {
     }
     case INTSXP: {
       Rcpp::IntegerVector iv = Rcpp::as< Rcpp::IntegerVector >( this_vec );
-      if( factors_as_string && Rf_isFactor( this_vec ) ) {
-        Rcpp::CharacterVector lvls = iv.attr("levels");
-        if ( lvls.length() == 0 ) {
-          // no levls - from NA_character_ vector
-          
-          Rcpp::StringVector s(1);
-          s[0] = NA_STRING;
-          int ele = 0;
-          jsonify::writers::simple::write_value( writer, s, ele );
-        } else {
-          int this_int = iv[ row ];
-          const char * this_char = lvls[ this_int -1 ];
-          writer.String( this_char );
-        }
-        
-      } else {
-        jsonify::writers::simple::write_value( writer, iv, row, numeric_dates, factors_as_string );
-      }
+      jsonify::writers::simple::write_value( writer, iv, row, numeric_dates, factors_as_string );
       break;
     }
     case LGLSXP: {
@@ -123,11 +104,256 @@ namespace complex {
       int digits = -1, 
       bool numeric_dates = true,
       bool factors_as_string = true, 
-      std::string by = "row", 
+      jsonify::utils::by_type by = jsonify::utils::BY_ROW, 
       int row = -1   // for when we are recursing into a row of a data.frame
+  );
+  
+  /*
+   * writes a single row of a data.frame as an object, using the
+   * cell-writers from the data.frame's plan (see row_plan())
+   */
+  template< typename Writer >
+  inline void write_row(
+      Writer& writer,
+      std::vector< jsonify::writers::plan::column< Writer > >& plan,
+      int row,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by
+  ) {
+    
+    int df_col;
+    int n_cols = plan.size();
+    
+    writer.StartObject();
+    for( df_col = 0; df_col < n_cols; df_col++ ) {
+      
+      jsonify::writers::plan::column< Writer >& col = plan[ df_col ];
+      jsonify::writers::plan::write_key( writer, col );
+      
+      if ( col.write != NULL ) {
+        col.write( writer, col, row );
+      } else if ( TYPEOF( col.vec ) == VECSXP ) {
+        write_value( writer, col.vec, unbox, digits, numeric_dates, factors_as_string, by, row );
+      } else {
+        switch_vector( writer, col.vec, unbox, digits, numeric_dates, factors_as_string, row );
+      }
+    }
+    writer.EndObject();
+  }
+
+  /*
+   * writes element 'row' of a list (a list column of a data.frame) inside an
+   * array or, if the list has names, an object keyed by the element's name
+   * (or "1" if it's blank)
+   */
+  template< typename Writer >
+  inline void write_list_element(
+      Writer& writer,
+      SEXP lst,
+      SEXP names,
+      int row,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by
+  ) {
+    
+    bool has_names = !Rf_isNull( names );
+    jsonify::utils::writer_starter( writer, has_names );
+    if ( has_names ) {
+      const char* name = CHAR( STRING_ELT( names, row ) );
+      writer.String( name[0] == '\0' ? "1" : name );
+    }
+    write_value( writer, VECTOR_ELT( lst, row ), unbox, digits, numeric_dates, factors_as_string, by );
+    jsonify::utils::writer_ender( writer, has_names );
+  }
+  
+  template< typename Writer >
+  inline void write_list_cell( Writer& writer, const jsonify::writers::plan::column< Writer >& col, int row ) {
+    write_list_element( 
+      writer, col.vec, col.names, row, col.unbox, col.digits, col.numeric_dates, col.factors_as_string, col.by 
+    );
+  }
+  
+  template< typename Writer >
+  inline void write_data_frame_cell( Writer& writer, const jsonify::writers::plan::column< Writer >& col, int row ) {
+    write_row( 
+      writer, *col.nested, row, col.unbox, col.digits, col.numeric_dates, col.factors_as_string, col.by 
+    );
+  }
+  
+  /*
+   * a data.frame's plan, with cell-writers for its list columns, and a plan of
+   * its own for each data.frame column, so neither allocates for each row
+   */
+  template< typename Writer >
+  inline std::vector< jsonify::writers::plan::column< Writer > > row_plan(
+      SEXP df,
+      const jsonify::utils::selection& cols,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by,
+      bool all_rows = true
+  ) {
+    
+    size_t i;
+    std::vector< jsonify::writers::plan::column< Writer > > plan = 
+      jsonify::writers::plan::data_frame_plan< Writer >( df, cols, digits, numeric_dates, factors_as_string, all_rows );
+    
+    for ( i = 0; i < plan.size(); i++ ) {
+      jsonify::writers::plan::column< Writer >& col = plan[i];
+      if ( TYPEOF( col.vec ) != VECSXP ) {
+        continue;
+      }
+      col.unbox = unbox;
+      col.by = by;
+      if ( Rf_inherits( col.vec, "data.frame" ) ) {
+        col.nested.reset( new std::vector< jsonify::writers::plan::column< Writer > >(
+          row_plan< Writer >( 
+            col.vec, jsonify::utils::select_all( Rf_length( col.vec ) ), 
+            unbox, digits, numeric_dates, factors_as_string, by, all_rows 
+          )
+        ) );
+        col.write = write_data_frame_cell< Writer >;
+      } else {
+        col.names = Rf_getAttrib( col.vec, R_NamesSymbol );
+        col.write = write_list_cell< Writer >;
+      }
+    }
+    return plan;
+  }
+
+  template< typename Writer >
+  inline std::vector< jsonify::writers::plan::column< Writer > > row_plan(
+      SEXP df,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by,
+      bool all_rows = true
+  ) {
+    return row_plan< Writer >( 
+      df, jsonify::utils::select_all( Rf_length( df ) ), unbox, digits, numeric_dates, factors_as_string, by, all_rows 
+    );
+  }
+
+  /*
+   * writes the selected rows and columns of a data.frame, in the order 
+   * selected, reading each cell from the data.frame rather than from a copy
+   * of the subset. A whole data.frame is written with everything selected.
+   * 
+   * When fewer than half the rows are selected, or there are only a few, the
+   * columns aren't scanned for NAs, nor their strings cached (see 
+   * plan::data_frame_plan())
+   */
+  template< typename Writer >
+  inline void write_data_frame(
+      Writer& writer,
+      SEXP df,
+      const jsonify::utils::selection& rows,
+      const jsonify::utils::selection& cols,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by
+  ) {
+    
+    int i, j;
+    int n_rows = jsonify::utils::data_frame_rows( df );
+    bool all_rows = rows.size() * 2 >= n_rows && n_rows >= jsonify::writers::plan::MIN_SCANNED_ROWS;
+    
+    std::vector< jsonify::writers::plan::column< Writer > > plan = row_plan< Writer >(
+      df, cols, unbox, digits, numeric_dates, factors_as_string, by, all_rows
+    );
+    
+    if ( by == jsonify::utils::BY_ROW ) {
+      writer.StartArray();
+      for ( i = 0; i < rows.size(); i++ ) {
+        write_row( writer, plan, rows[i], unbox, digits, numeric_dates, factors_as_string, by );
+      }
+      writer.EndArray();
+      return;
+    }
+    
+    // by-column, each column is an array (or object, for a named list) of
+    // the selected rows
+    bool unbox_col = jsonify::utils::should_unbox( rows.size(), unbox );
+    char position[ 16 ];
+    
+    writer.StartObject();
+    for ( j = 0; j < static_cast< int >( plan.size() ); j++ ) {
+      
+      jsonify::writers::plan::column< Writer >& col = plan[j];
+      jsonify::writers::plan::write_key( writer, col );
+      
+      if ( Rf_inherits( col.vec, "data.frame" ) ) {
+        write_data_frame( 
+          writer, col.vec, rows, jsonify::utils::select_all( Rf_length( col.vec ) ), 
+          unbox, digits, numeric_dates, factors_as_string, by 
+        );
+      } else if ( TYPEOF( col.vec ) == VECSXP ) {
+        // an empty list is always an array
+        bool has_names = rows.size() > 0 && !Rf_isNull( col.names );
+        jsonify::utils::writer_starter( writer, has_names );
+        for ( i = 0; i < rows.size(); i++ ) {
+          if ( has_names ) {
+            SEXP name = STRING_ELT( col.names, rows[i] );
+            if ( LENGTH( name ) == 0 ) {
+              int len = std::snprintf( position, sizeof( position ), "%d", rows[i] + 1 );
+              writer.String( position, len );
+            } else {
+              writer.String( CHAR( name ), LENGTH( name ) );
+            }
+          }
+          write_value( writer, VECTOR_ELT( col.vec, rows[i] ), unbox, digits, numeric_dates, factors_as_string, by );
+        }
+        jsonify::utils::writer_ender( writer, has_names );
+      } else if ( factors_as_string && Rf_isFactor( col.vec ) && Rf_length( col.levels ) == 0 ) {
+        // no levels - from NA_character_ vector
+        writer.Null();
+      } else if ( col.write != NULL ) {
+        bool unbox_this = jsonify::utils::is_json( col.vec ) 
+          ? jsonify::utils::should_unbox_json( rows.size() ) 
+          : unbox_col;
+        jsonify::utils::start_array( writer, unbox_this );
+        for ( i = 0; i < rows.size(); i++ ) {
+          col.write( writer, col, rows[i] );
+        }
+        jsonify::utils::end_array( writer, unbox_this );
+      } else {
+        // other types are written as strings, converted once for the column
+        Rcpp::StringVector sv = Rcpp::as< Rcpp::StringVector >( col.vec );
+        jsonify::utils::start_array( writer, unbox_col );
+        for ( i = 0; i < rows.size(); i++ ) {
+          jsonify::writers::simple::write_value( writer, sv, rows[i] );
+        }
+        jsonify::utils::end_array( writer, unbox_col );
+      }
+    }
+    writer.EndObject();
+  }
+
+  template< typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      SEXP list_element, 
+      bool unbox, 
+      int digits, 
+      bool numeric_dates,
+      bool factors_as_string, 
+      jsonify::utils::by_type by, 
+      int row
   ) {
     
-    int i, df_col, df_row;
+    int i;
     
     if( Rf_isNull( list_element ) ) {
       writer.StartObject();
@@ -135,6 +361,15 @@ namespace complex {
       return;
     } 
     
+    if ( jsonify::utils::is_json( list_element ) ) {
+      if ( row >= 0 ) {
+        jsonify::writers::simple::write_json( writer, list_element, row );
+      } else {
+        jsonify::writers::simple::write_json( writer, list_element );
+      }
+      return;
+    }
+    
     if( Rf_isMatrix( list_element ) ) {
       
       switch( TYPEOF( list_element ) ) {
@@ -161,87 +396,16 @@ namespace complex {
       }
     } else if ( Rf_inherits( list_element, "data.frame" ) ) {
       
-      Rcpp::DataFrame df = Rcpp::as< Rcpp::DataFrame >( list_element );
-      int n_cols = df.ncol();
-      int n_rows = df.nrows();
-      Rcpp::StringVector column_names = df.names();
-      
-      if ( by == "column") {
-        writer.StartObject();
-        
-        for( df_col = 0; df_col < n_cols; df_col++ ) {
-
-          const char *h = column_names[ df_col ];
-          writer.String( h );
-          SEXP this_vec = df[ h ];
-          
-          switch( TYPEOF( this_vec ) ) {
-          case VECSXP: {
-            write_value( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, by );
-            break;
-          }
-          default: {
-            switch_vector( writer, this_vec, unbox, digits, numeric_dates, factors_as_string );
-          }
-          }
-        }
-        writer.EndObject();
-        
-      } else { // by == "row"
-        
-        if ( row >= 0 ) {
-          
-          writer.StartObject();
-          for( df_col = 0; df_col < n_cols; df_col++ ) {
-            
-            const char *h = column_names[ df_col ];
-            writer.String( h );
-            
-            SEXP this_vec = df[ h ];
-            
-            switch( TYPEOF( this_vec ) ) {
-            case VECSXP: {
-              Rcpp::List lst = Rcpp::as< Rcpp::List >( this_vec );
-              write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by, row );
-              break;
-            }
-            default: {
-              switch_vector( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, row );
-            }
-            } // end switch
-            
-          } // end for
-          writer.EndObject();
-          
-        } else {
-          
-          writer.StartArray();
-          
-          for( df_row = 0; df_row < n_rows; df_row++ ) {
-            writer.StartObject();
-            
-            for( df_col = 0; df_col < n_cols; df_col++ ) {
-              
-              const char *h = column_names[ df_col ];
-              writer.String( h );
-              SEXP this_vec = df[ h ];
-              
-              switch( TYPEOF( this_vec ) ) {
-              case VECSXP: {
-                Rcpp::List lst = Rcpp::as< Rcpp::List >( this_vec );
-                write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by, df_row );
-                break;
-              }
-              default: {
-                switch_vector( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, df_row );
-              }
-              }
-            }
-            writer.EndObject();
-          } // end for
-          writer.EndArray();
-        } // end if
-      }
+      // read straight from the SEXP, as this may be one of many data.frames
+      // nested in a list column. It's always written whole; a row of a 
+      // data.frame column is written by the cell-writer row_plan() gives it, 
+      // with a plan made once for the column
+      write_data_frame(
+        writer, list_element, 
+        jsonify::utils::select_all( jsonify::utils::data_frame_rows( list_element ) ), 
+        jsonify::utils::select_all( Rf_length( list_element ) ),
+        unbox, digits, numeric_dates, factors_as_string, by
+      );
       
     } else {
       
@@ -252,28 +416,17 @@ namespace complex {
       case VECSXP: {
         // the case where the list item is a row of a data.frame
         // ISSUE #32
-        Rcpp::List temp_lst = Rcpp::as< Rcpp::List >( list_element );
         bool has_names;
         
-        has_names = temp_lst.hasAttribute("names");
-        
-        Rcpp::List lst(1);
         if( row >= 0 ) {   // we came in from a data.frame, going by-row
           // ISSUE 32
-          lst[0] = temp_lst[ row ];
-          
-          if( temp_lst.hasAttribute("names") ) {
-            Rcpp::CharacterVector templstnames = temp_lst.names();
-            const char* this_name = templstnames[ row ];
-            lst.names() = this_name;
-          }
-
-          write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by );  
+          write_list_element( 
+            writer, list_element, Rf_getAttrib( list_element, R_NamesSymbol ), row, 
+            unbox, digits, numeric_dates, factors_as_string, by 
+          );
           
         } else {
-          lst = temp_lst;
-
-          int n = lst.size();
+          int n = Rf_length( list_element );
           
           if ( n == 0 ) {
             writer.StartArray();
@@ -282,28 +435,25 @@ namespace complex {
           }
           
           // LIST NAMES
-          Rcpp::IntegerVector int_names = Rcpp::seq(1, lst.size());
-          Rcpp::CharacterVector list_names = Rcpp::as< Rcpp::CharacterVector >( int_names );
-          has_names = lst.hasAttribute("names");
-          
-          if ( has_names ) {
-            Rcpp::CharacterVector temp_names = lst.names();
-            for( i = 0; i < n; i++ ) {
-              list_names[i] = temp_names[i] == "" ? list_names[i] : temp_names[i];
-            }
-          }
-          // END LIST NAMES
+          // a blank name is written as the element's (1-based) position
+          SEXP names = Rf_getAttrib( list_element, R_NamesSymbol );
+          has_names = !Rf_isNull( names );
+          char position[ 16 ];
           
           jsonify::utils::writer_starter( writer, has_names );
           
           for ( i = 0; i < n; i++ ) {
             
-            SEXP recursive_list = lst[ i ];
             if ( has_names ) {
-              const char *s = list_names[ i ];
-              writer.String( s );
+              SEXP name = STRING_ELT( names, i );
+              if ( LENGTH( name ) == 0 ) {
+                int len = std::snprintf( position, sizeof( position ), "%d", i + 1 );
+                writer.String( position, len );
+              } else {
+                writer.String( CHAR( name ), LENGTH( name ) );
+              }
             }
-            write_value( writer, recursive_list, unbox, digits, numeric_dates, factors_as_string, by );
+            write_value( writer, VECTOR_ELT( list_element, i ), unbox, digits, numeric_dates, factors_as_string, by );
           }
         jsonify::utils::writer_ender( writer, has_names );
         } // end if (by row)
@@ -350,6 +500,82 @@ namespace complex {
     }
   }
 
+  /*
+   * for callers passing 'by' as "row" or "column"
+   */
+  template< typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      SEXP list_element, 
+      bool unbox, 
+      int digits, 
+      bool numeric_dates,
+      bool factors_as_string, 
+      const std::string& by, 
+      int row = -1
+  ) {
+    write_value( writer, list_element, unbox, digits, numeric_dates, factors_as_string, jsonify::utils::to_by( by ), row );
+  }
+
+  inline int n_records( SEXP x ) {
+    if ( Rf_inherits( x, "data.frame" ) ) {
+      return jsonify::utils::data_frame_rows( x );
+    } else if ( TYPEOF( x ) == VECSXP ) {
+      return Rf_length( x );
+    }
+    return 1;
+  }
+  
+  /*
+   * writes each row of a data.frame, or each element of a list, as its own 
+   * JSON document (e.g. for NDJSON). Any other object is a single record. 
+   * 
+   * The RecordHandler is told when each record starts and ends
+   * - start( writer, i ) must reset the writer so it can accept a new root value
+   * - end( writer, i )
+   */
+  template< typename Writer, typename RecordHandler >
+  inline void write_records(
+      Writer& writer,
+      RecordHandler& handler,
+      SEXP x,
+      bool unbox = false,
+      int digits = -1,
+      bool numeric_dates = true,
+      bool factors_as_string = true,
+      jsonify::utils::by_type by = jsonify::utils::BY_ROW
+  ) {
+    
+    int i;
+    int n = n_records( x );
+    
+    if ( Rf_inherits( x, "data.frame" ) ) {
+      
+      std::vector< jsonify::writers::plan::column< Writer > > plan = 
+        row_plan< Writer >( x, unbox, digits, numeric_dates, factors_as_string, by );
+      
+      for ( i = 0; i < n; i++ ) {
+        handler.start( writer, i );
+        write_row( writer, plan, i, unbox, digits, numeric_dates, factors_as_string, by );
+        handler.end( writer, i );
+      }
+      
+    } else if ( TYPEOF( x ) == VECSXP ) {
+      
+      for ( i = 0; i < n; i++ ) {
+        handler.start( writer, i );
+        write_value( writer, VECTOR_ELT( x, i ), unbox, digits, numeric_dates, factors_as_string, by );
+        handler.end( writer, i );
+      }
+      
+    } else {
+      
+      handler.start( writer, 0 );
+      write_value( writer, x, unbox, digits, numeric_dates, factors_as_string, by );
+      handler.end( writer, 0 );
+    }
+  }
+
 } // namespace complex
 } // namespace writers
 } // namespace jsonify
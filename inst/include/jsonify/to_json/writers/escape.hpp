@@ -0,0 +1,95 @@
+#ifndef R_JSONIFY_WRITERS_ESCAPE_H
+#define R_JSONIFY_WRITERS_ESCAPE_H
+
+#include <cstring>
+#include <cstdint>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#define JSONIFY_ESCAPE_SSE2
+#include <emmintrin.h>
+#elif defined( __aarch64__ ) && defined( __ARM_NEON )
+#define JSONIFY_ESCAPE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace jsonify {
+namespace writers {
+namespace escape {
+
+  /*
+   * The rapidjson Writer escapes control characters, '"' and '\', and writes
+   * every other byte (including UTF-8) as it is. needs_escaping() checks a
+   * string for those characters 16 (or 8) bytes at a time, so strings without
+   * any can be copied into the JSON rather than escaped byte by byte.
+   *
+   * SSE2 and NEON are part of the x86-64 and arm64 baselines, so they're
+   * chosen when compiling; other platforms check a 64-bit word at a time.
+   * Only whole blocks inside the string are loaded, never past its end.
+   */
+  inline bool needs_escaping( unsigned char c ) {
+    return c < 0x20 || c == '"' || c == '\\';
+  }
+
+  inline bool needs_escaping( const char* s, size_t length ) {
+    size_t i = 0;
+
+#if defined( JSONIFY_ESCAPE_SSE2 )
+    const __m128i quote = _mm_set1_epi8( '"' );
+    const __m128i backslash = _mm_set1_epi8( '\\' );
+    const __m128i control = _mm_set1_epi8( 0x1F );
+    for ( ; i + 16 <= length; i += 16 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( s + i ) );
+      // unsigned v <= 0x1F when max( v, 0x1F ) == 0x1F
+      __m128i found = _mm_or_si128(
+        _mm_or_si128( _mm_cmpeq_epi8( v, quote ), _mm_cmpeq_epi8( v, backslash ) ),
+        _mm_cmpeq_epi8( _mm_max_epu8( v, control ), control )
+      );
+      if ( _mm_movemask_epi8( found ) != 0 ) {
+        return true;
+      }
+    }
+#elif defined( JSONIFY_ESCAPE_NEON )
+    const uint8x16_t quote = vdupq_n_u8( '"' );
+    const uint8x16_t backslash = vdupq_n_u8( '\\' );
+    const uint8x16_t space = vdupq_n_u8( 0x20 );
+    for ( ; i + 16 <= length; i += 16 ) {
+      uint8x16_t v = vld1q_u8( reinterpret_cast< const uint8_t* >( s + i ) );
+      uint8x16_t found = vorrq_u8(
+        vorrq_u8( vceqq_u8( v, quote ), vceqq_u8( v, backslash ) ),
+        vcltq_u8( v, space )
+      );
+      if ( vmaxvq_u8( found ) != 0 ) {
+        return true;
+      }
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    for ( ; i + 8 <= length; i += 8 ) {
+      uint64_t v;
+      std::memcpy( &v, s + i, 8 );
+      uint64_t q = v ^ ( ones * '"' );
+      uint64_t b = v ^ ( ones * '\\' );
+      // a byte's high bit is set by subtracting if it's < 0x20, or if it's zero
+      // after the xor (i.e. a match). Bytes >= 0x80 are masked out by ~v, and
+      // q and b have the same high bits as v
+      uint64_t found = ( ( v - ones * 0x20 ) | ( q - ones ) | ( b - ones ) ) & ~v & highs;
+      if ( found != 0 ) {
+        return true;
+      }
+    }
+#endif
+
+    for ( ; i < length; i++ ) {
+      if ( needs_escaping( static_cast< unsigned char >( s[i] ) ) ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+} // namespace escape
+} // namespace writers
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef R_JSONIFY_WRITERS_ESTIMATE_H
+#define R_JSONIFY_WRITERS_ESTIMATE_H
+
+#include <Rcpp.h>
+#include "jsonify/to_json/utils.hpp"
+#include "jsonify/buffers/buffers.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace writers {
+namespace estimate {
+
+  /*
+   * Estimates the size of the JSON of an object from a sample of its values,
+   * so the output buffer can be reserved once rather than grown (and copied)
+   * as it's written.
+   *
+   * 'budget' is the number of values which may be sampled. A list passes an
+   * even share of its budget to each element it samples, so nested lists are
+   * sampled in roughly the same time as flat ones.
+   */
+  const int BUDGET = 1000;
+
+  // bytes for "null" and for a separating comma
+  const double NULL_SIZE = 4;
+  const double SEPARATOR_SIZE = 1;
+
+  // quoted "YYYY-MM-DD" and "YYYY-MM-DDTHH:MM:SS"
+  const double DATE_SIZE = 12;
+  const double POSIXCT_SIZE = 21;
+
+  inline R_xlen_t n_samples( R_xlen_t n, int budget ) {
+    return n < budget ? n : ( budget > 0 ? budget : 1 );
+  }
+
+  inline R_xlen_t sample_index( R_xlen_t j, R_xlen_t k, R_xlen_t n ) {
+    return static_cast< R_xlen_t >( static_cast< double >( j ) * n / k );
+  }
+
+  inline double int_size( int value ) {
+    if ( value == NA_INTEGER ) {
+      return NULL_SIZE;
+    }
+    double size = value < 0 ? 2 : 1;
+    unsigned int u = value < 0 ? -static_cast< unsigned int >( value ) : value;
+    while ( u >= 10 ) {
+      u /= 10;
+      size++;
+    }
+    return size;
+  }
+
+  inline double string_size( SEXP s ) {
+    return s == NA_STRING ? NULL_SIZE : LENGTH( s ) + 2;
+  }
+
+  /*
+   * the average size of an element of an atomic vector, including its separator
+   */
+  inline double element_size(
+      SEXP vec,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      int budget
+    ) {
+
+    R_xlen_t j, i;
+    R_xlen_t n = Rf_xlength( vec );
+    if ( n == 0 ) {
+      return 0;
+    }
+    R_xlen_t k = n_samples( n, budget );
+    double size = 0;
+
+    bool is_date = !numeric_dates && Rf_inherits( vec, "Date" );
+    bool is_posixct = !numeric_dates && Rf_inherits( vec, "POSIXt" );
+
+    switch( TYPEOF( vec ) ) {
+    case LGLSXP: {
+      const int* p = LOGICAL( vec );
+      for ( j = 0; j < k; j++ ) {
+        int value = p[ sample_index( j, k, n ) ];
+        size += value == NA_LOGICAL ? NULL_SIZE : ( value ? 4 : 5 );
+      }
+      break;
+    }
+    case INTSXP: {
+      const int* p = INTEGER( vec );
+      SEXP lvls = Rf_getAttrib( vec, R_LevelsSymbol );
+      bool is_factor = factors_as_string && Rf_isFactor( vec ) && !Rf_isNull( lvls );
+      for ( j = 0; j < k; j++ ) {
+        int value = p[ sample_index( j, k, n ) ];
+        if ( value == NA_INTEGER ) {
+          size += NULL_SIZE;
+        } else if ( is_date ) {
+          size += DATE_SIZE;
+        } else if ( is_posixct ) {
+          size += POSIXCT_SIZE;
+        } else if ( is_factor ) {
+          size += value > 0 && value <= Rf_length( lvls ) ? string_size( STRING_ELT( lvls, value - 1 ) ) : NULL_SIZE;
+        } else {
+          size += int_size( value );
+        }
+      }
+      break;
+    }
+    case REALSXP: {
+      const double* p = REAL( vec );
+      double scale = jsonify::writers::scalars::power_of_ten( digits );
+      rapidjson::StringBuffer sb;
+      rapidjson::Writer< rapidjson::StringBuffer > writer( sb );
+      for ( j = 0; j < k; j++ ) {
+        double value = p[ sample_index( j, k, n ) ];
+        if ( !R_FINITE( value ) ) {
+          size += ISNAN( value ) ? NULL_SIZE : 6;
+        } else if ( is_date ) {
+          size += DATE_SIZE;
+        } else if ( is_posixct ) {
+          size += POSIXCT_SIZE;
+        } else {
+          sb.Clear();
+          writer.Reset( sb );
+          jsonify::writers::scalars::write_value( writer, value, digits, scale );
+          size += sb.GetSize();
+        }
+      }
+      break;
+    }
+    case STRSXP: {
+      for ( j = 0; j < k; j++ ) {
+        i = sample_index( j, k, n );
+        size += string_size( STRING_ELT( vec, i ) );
+      }
+      break;
+    }
+    default: {
+      return 0;
+    }
+    }
+    return size / k + SEPARATOR_SIZE;
+  }
+
+  /*
+   * the size of 'name', quoted, with a colon and a separator
+   */
+  inline double name_size( SEXP names, R_xlen_t i ) {
+    return Rf_isNull( names ) ? 0 : LENGTH( STRING_ELT( names, i ) ) + 4;
+  }
+
+  inline double value_size(
+      SEXP x,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      bool by_row,
+      int budget
+    ) {
+
+    R_xlen_t j, i;
+    R_xlen_t n = Rf_xlength( x );
+
+    if ( Rf_isNull( x ) ) {
+      return 2;
+    }
+
+    if ( Rf_isMatrix( x ) ) {
+      // a bracket either side of each row (or column) and the whole matrix
+      double n_arrays = by_row ? Rf_nrows( x ) : Rf_ncols( x );
+      return element_size( x, digits, numeric_dates, factors_as_string, budget ) * n + n_arrays * 2 + 2;
+    }
+
+    if ( Rf_inherits( x, "data.frame" ) ) {
+      SEXP names = Rf_getAttrib( x, R_NamesSymbol );
+      R_xlen_t n_rows = n == 0 ? 0 : Rf_xlength( VECTOR_ELT( x, 0 ) );
+      int col_budget = n == 0 ? budget : budget / static_cast< int >( n < budget ? n : budget );
+      double size = 2;
+      for ( i = 0; i < n; i++ ) {
+        SEXP col = VECTOR_ELT( x, i );
+        double col_size = TYPEOF( col ) == VECSXP
+          ? value_size( col, digits, numeric_dates, factors_as_string, by_row, col_budget )
+          : element_size( col, digits, numeric_dates, factors_as_string, col_budget ) * n_rows + 2;
+        if ( by_row ) {
+          // each row repeats the column names, and is an object
+          size += col_size + name_size( names, i ) * n_rows;
+        } else {
+          size += col_size + name_size( names, i );
+        }
+      }
+      if ( by_row ) {
+        size += n_rows * 3.0 - 2;
+      }
+      return size;
+    }
+
+    if ( TYPEOF( x ) == VECSXP ) {
+      if ( n == 0 ) {
+        return 2;
+      }
+      SEXP names = Rf_getAttrib( x, R_NamesSymbol );
+      R_xlen_t k = n_samples( n, budget );
+      int child_budget = budget / static_cast< int >( k );
+      double size = 0;
+      for ( j = 0; j < k; j++ ) {
+        i = sample_index( j, k, n );
+        size += value_size( VECTOR_ELT( x, i ), digits, numeric_dates, factors_as_string, by_row, child_budget ) +
+          name_size( names, i ) + SEPARATOR_SIZE;
+      }
+      return size / k * n + 2;
+    }
+
+    return element_size( x, digits, numeric_dates, factors_as_string, budget ) * n + 2;
+  }
+
+  /*
+   * The most reserved up front. A sample can overestimate a large, skewed list 
+   * many times over, and a buffer lease keeps what it reserved, so beyond the 
+   * size a lease keeps the buffer grows as it's written instead
+   */
+  const size_t MAX_RESERVE = jsonify::buffers::MAX_POOLED_SIZE;
+
+  /*
+   * the number of bytes to reserve for the JSON of 'x', with some headroom for
+   * escaped characters and sampling error, up to MAX_RESERVE
+   */
+  inline size_t size(
+      SEXP x,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      jsonify::utils::by_type by
+    ) {
+    double size = value_size( x, digits, numeric_dates, factors_as_string, by == jsonify::utils::BY_ROW, BUDGET );
+    size += size / 8;
+    return size < MAX_RESERVE ? static_cast< size_t >( size ) : MAX_RESERVE;
+  }
+
+} // namespace estimate
+} // namespace writers
+} // namespace jsonify
+
+#endif
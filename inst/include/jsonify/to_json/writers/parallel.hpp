@@ -0,0 +1,138 @@
+#ifndef R_JSONIFY_WRITERS_PARALLEL_H
+#define R_JSONIFY_WRITERS_PARALLEL_H
+
+#include <Rcpp.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "jsonify/to_json/writers/plan.hpp"
+#include "jsonify/to_json/writers/estimate.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace writers {
+namespace parallel {
+
+  // fewer rows than this per thread isn't worth starting a thread for
+  const int MIN_ROWS_PER_THREAD = 10000;
+
+  typedef rapidjson::Writer< rapidjson::StringBuffer > writer_type;
+  typedef jsonify::writers::plan::column< writer_type > column_type;
+
+  /*
+   * writes rows [ start, end ) as an array. Must not use the R API
+   */
+  inline void write_rows(
+      rapidjson::StringBuffer* sb,
+      const std::vector< column_type >* plan,
+      int start,
+      int end
+    ) {
+
+    int row;
+    size_t col;
+    size_t n_cols = plan->size();
+    writer_type writer( *sb );
+
+    writer.StartArray();
+    for ( row = start; row < end; row++ ) {
+      writer.StartObject();
+      for ( col = 0; col < n_cols; col++ ) {
+        const column_type& c = ( *plan )[ col ];
+        jsonify::writers::plan::write_key( writer, c );
+        c.write( writer, c, row );
+      }
+      writer.EndObject();
+    }
+    writer.EndArray();
+  }
+
+  inline int n_threads( int threads, int n_rows ) {
+    int max_threads = n_rows / MIN_ROWS_PER_THREAD;
+    if ( threads > max_threads ) {
+      threads = max_threads;
+    }
+    return threads;
+  }
+
+  /*
+   * Writes a data.frame by-row, with the rows split into chunks which are each
+   * written by their own thread into their own buffer, then joined in order.
+   *
+   * Returns false (having written nothing) if it's not worth using threads,
+   * or if a column can only be written on R's main thread
+   */
+  inline bool write_data_frame(
+      rapidjson::StringBuffer& sb,
+      SEXP df,
+      int threads,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string
+    ) {
+
+    int n_rows = jsonify::utils::data_frame_rows( df );
+    threads = n_threads( threads, n_rows );
+    if ( threads < 2 ) {
+      return false;
+    }
+
+    std::vector< column_type > plan = jsonify::writers::plan::data_frame_plan< writer_type >(
+      df, digits, numeric_dates, factors_as_string
+    );
+    if ( !jsonify::writers::plan::extract( plan ) ) {
+      return false;
+    }
+
+    int i;
+    int chunk = ( n_rows + threads - 1 ) / threads;
+    std::vector< rapidjson::StringBuffer > buffers( threads );
+    std::vector< std::thread > workers;
+    workers.reserve( threads );
+
+    size_t chunk_size = jsonify::writers::estimate::size( df, digits, numeric_dates, factors_as_string, jsonify::utils::BY_ROW ) / threads;
+    for ( i = 0; i < threads; i++ ) {
+      buffers[i].Reserve( chunk_size );
+    }
+
+    for ( i = 0; i < threads; i++ ) {
+      int start = i * chunk;
+      int end = start + chunk < n_rows ? start + chunk : n_rows;
+      workers.push_back( std::thread( write_rows, &buffers[i], &plan, start, end ) );
+    }
+    for ( i = 0; i < threads; i++ ) {
+      workers[i].join();
+    }
+
+    // each chunk is an array; join their contents into a single array
+    size_t size = 0;
+    for ( i = 0; i < threads; i++ ) {
+      size += buffers[i].GetSize();
+    }
+    sb.Reserve( size );
+    bool first = true;
+    sb.Put('[');
+    for ( i = 0; i < threads; i++ ) {
+      size_t n = buffers[i].GetSize() - 2;
+      if ( n == 0 ) {
+        continue;
+      }
+      if ( !first ) {
+        sb.Put(',');
+      }
+      std::memcpy( sb.Push( n ), buffers[i].GetString() + 1, n );
+      first = false;
+    }
+    sb.Put(']');
+    return true;
+  }
+
+} // namespace parallel
+} // namespace writers
+} // namespace jsonify
+
+#endif
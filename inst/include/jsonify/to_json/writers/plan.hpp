@@ -0,0 +1,450 @@
+#ifndef R_JSONIFY_WRITERS_PLAN_H
+#define R_JSONIFY_WRITERS_PLAN_H
+
+#include <Rcpp.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/dates/dates.hpp"
+#include "jsonify/to_json/factors/factors.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+#include "jsonify/to_json/writers/strings.hpp"
+#include "jsonify/to_json/writers/escape.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace writers {
+namespace plan {
+
+  /*
+   * A 'plan' inspects each column of a data.frame once (type, class, levels, NAs)
+   * and selects a cell-writer for it, so writing by-row doesn't re-dispatch
+   * on every cell. Columns without a cell-writer (lists, data.frames and other
+   * types) are handled by the caller. complex::row_plan() adds cell-writers 
+   * for list and data.frame columns.
+   */
+  template< typename Writer >
+  struct column {
+    typedef void ( *cell_writer )( Writer& writer, const column< Writer >& col, int row );
+
+    const char* name;
+    std::string key;    // the name, escaped and quoted
+    SEXP vec;
+    cell_writer write;
+    const int* int_data;
+    const double* real_data;
+    SEXP levels;
+    std::shared_ptr< jsonify::factors::levels > factor_levels;
+    std::shared_ptr< std::vector< const char* > > strings;
+    std::shared_ptr< std::vector< int > > string_lengths;
+    std::shared_ptr< jsonify::writers::strings::cache > string_cache;
+    int digits;
+    double scale;
+
+    // list and data.frame columns, whose cell-writers are set in complex.hpp
+    bool unbox;
+    bool numeric_dates;
+    bool factors_as_string;
+    jsonify::utils::by_type by;
+    SEXP names;
+    std::shared_ptr< std::vector< column< Writer > > > nested;
+  };
+
+  // ---------------------------------------------------------------------------
+  // names
+  // ---------------------------------------------------------------------------
+  /*
+   * a column's name as JSON, escaped and quoted once when the plan is built
+   * rather than for every row
+   */
+  inline std::string quote_name( const char* name, size_t length ) {
+    if ( !jsonify::writers::escape::needs_escaping( name, length ) ) {
+      std::string key;
+      key.reserve( length + 2 );
+      key += '"';
+      key.append( name, length );
+      key += '"';
+      return key;
+    }
+    rapidjson::StringBuffer sb;
+    rapidjson::Writer< rapidjson::StringBuffer > writer( sb );
+    writer.String( name, static_cast< rapidjson::SizeType >( length ) );
+    return std::string( sb.GetString(), sb.GetSize() );
+  }
+
+  /*
+   * writes the column's name as the key of a row's (or the data.frame's) object
+   */
+  template< typename Writer >
+  inline void write_key( Writer& writer, const column< Writer >& col ) {
+    writer.RawValue( col.key.data(), col.key.size(), rapidjson::kStringType );
+  }
+
+  // ---------------------------------------------------------------------------
+  // cell writers
+  // ---------------------------------------------------------------------------
+  template< typename Writer >
+  inline void write_logical( Writer& writer, const column< Writer >& col, int row ) {
+    int value = col.int_data[ row ];
+    if ( value == NA_LOGICAL ) {
+      writer.Null();
+    } else {
+      writer.Bool( value != 0 );
+    }
+  }
+
+  template< typename Writer >
+  inline void write_logical_no_na( Writer& writer, const column< Writer >& col, int row ) {
+    writer.Bool( col.int_data[ row ] != 0 );
+  }
+
+  template< typename Writer >
+  inline void write_integer( Writer& writer, const column< Writer >& col, int row ) {
+    int value = col.int_data[ row ];
+    if ( value == NA_INTEGER ) {
+      writer.Null();
+    } else {
+      writer.Int( value );
+    }
+  }
+
+  template< typename Writer >
+  inline void write_integer_no_na( Writer& writer, const column< Writer >& col, int row ) {
+    writer.Int( col.int_data[ row ] );
+  }
+
+  // Rounded - whether the column is rounded to 'digits', chosen by the plan
+  template< typename Writer, bool Rounded >
+  inline void write_real( Writer& writer, const column< Writer >& col, int row ) {
+    double value = col.real_data[ row ];
+    if ( ISNAN( value ) ) {
+      writer.Null();
+    } else {
+      jsonify::writers::scalars::write_double< Rounded >( writer, value, col.digits, col.scale );
+    }
+  }
+
+  template< typename Writer, bool Rounded >
+  inline void write_real_no_na( Writer& writer, const column< Writer >& col, int row ) {
+    double value = col.real_data[ row ];
+    jsonify::writers::scalars::write_double< Rounded >( writer, value, col.digits, col.scale );
+  }
+
+  template< typename Writer >
+  inline void write_string( Writer& writer, const column< Writer >& col, int row ) {
+    SEXP s = STRING_ELT( col.vec, row );
+    if ( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      jsonify::writers::scalars::write_string( writer, s );
+    }
+  }
+
+  template< typename Writer >
+  inline void write_string_cached( Writer& writer, const column< Writer >& col, int row ) {
+    SEXP s = STRING_ELT( col.vec, row );
+    if ( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      col.string_cache->write( writer, s );
+    }
+  }
+
+  /*
+   * strings extracted from the CHARSXPs on the main thread; NULL is NA
+   */
+  template< typename Writer >
+  inline void write_string_extracted( Writer& writer, const column< Writer >& col, int row ) {
+    const char* s = ( *col.strings )[ row ];
+    if ( s == NULL ) {
+      writer.Null();
+    } else {
+      jsonify::writers::scalars::write_value( writer, s, ( *col.string_lengths )[ row ] );
+    }
+  }
+
+  template< typename Writer >
+  inline void write_json( Writer& writer, const column< Writer >& col, int row ) {
+    jsonify::writers::scalars::write_json( writer, STRING_ELT( col.vec, row ) );
+  }
+
+  template< typename Writer >
+  inline void write_json_extracted( Writer& writer, const column< Writer >& col, int row ) {
+    jsonify::writers::scalars::write_json( writer, ( *col.strings )[ row ], ( *col.string_lengths )[ row ] );
+  }
+
+  template< typename Writer >
+  inline void write_factor( Writer& writer, const column< Writer >& col, int row ) {
+    col.factor_levels->write( writer, col.int_data[ row ] );
+  }
+
+  template< typename Writer >
+  inline void write_factor_uncached( Writer& writer, const column< Writer >& col, int row ) {
+    jsonify::factors::write_value( writer, col.levels, col.int_data[ row ] );
+  }
+
+  /*
+   * dates may be stored as either integers or doubles
+   * returns false for NA
+   */
+  template< typename Writer >
+  inline bool date_value( const column< Writer >& col, int row, double& value ) {
+    if ( col.real_data != NULL ) {
+      value = col.real_data[ row ];
+      return !ISNAN( value );
+    }
+    int i = col.int_data[ row ];
+    value = i;
+    return i != NA_INTEGER;
+  }
+
+  template< typename Writer >
+  inline void write_date( Writer& writer, const column< Writer >& col, int row ) {
+    double value;
+    if ( !date_value( col, row, value ) ) {
+      writer.Null();
+    } else {
+      jsonify::dates::write_date( writer, value );
+    }
+  }
+
+  template< typename Writer >
+  inline void write_posixct( Writer& writer, const column< Writer >& col, int row ) {
+    double value;
+    if ( !date_value( col, row, value ) ) {
+      writer.Null();
+    } else {
+      jsonify::dates::write_posixct( writer, value );
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // plan builders
+  // ---------------------------------------------------------------------------
+  inline bool has_na( SEXP vec ) {
+    R_xlen_t i;
+    R_xlen_t n = Rf_xlength( vec );
+
+    switch( TYPEOF( vec ) ) {
+    case LGLSXP: {}
+    case INTSXP: {
+      const int* p = INTEGER( vec );
+      for ( i = 0; i < n; i++ ) {
+        if ( p[i] == NA_INTEGER ) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case REALSXP: {
+      const double* p = REAL( vec );
+      for ( i = 0; i < n; i++ ) {
+        if ( ISNAN( p[i] ) ) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case STRSXP: {
+      for ( i = 0; i < n; i++ ) {
+        if ( STRING_ELT( vec, i ) == NA_STRING ) {
+          return true;
+        }
+      }
+      return false;
+    }
+    }
+    return true;
+  }
+
+  /*
+   * selects the date cell-writer, or NULL if the column isn't written as dates
+   */
+  template< typename Writer >
+  inline typename column< Writer >::cell_writer date_writer( SEXP vec, bool numeric_dates ) {
+    if ( numeric_dates ) {
+      return NULL;
+    } else if ( Rf_inherits( vec, "Date" ) ) {
+      return write_date< Writer >;
+    } else if ( Rf_inherits( vec, "POSIXt" ) ) {
+      return write_posixct< Writer >;
+    }
+    return NULL;
+  }
+
+  template< typename Writer >
+  inline column< Writer > column_plan(
+      const char* name,
+      SEXP vec,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      bool all_rows
+    ) {
+
+    column< Writer > col;
+    col.name = name;
+    col.key = quote_name( name, std::strlen( name ) );
+    col.vec = vec;
+    col.write = NULL;
+    col.int_data = NULL;
+    col.real_data = NULL;
+    col.levels = R_NilValue;
+    col.digits = digits;
+    col.scale = jsonify::writers::scalars::power_of_ten( digits );
+    col.unbox = false;
+    col.numeric_dates = numeric_dates;
+    col.factors_as_string = factors_as_string;
+    col.by = jsonify::utils::BY_ROW;
+    col.names = R_NilValue;
+
+    switch( TYPEOF( vec ) ) {
+    case LGLSXP: {
+      col.int_data = LOGICAL( vec );
+      col.write = ( all_rows && !has_na( vec ) ) ? write_logical_no_na< Writer > : write_logical< Writer >;
+      break;
+    }
+    case INTSXP: {
+      col.int_data = INTEGER( vec );
+      col.write = date_writer< Writer >( vec, numeric_dates );
+      if ( col.write != NULL ) {
+        break;
+      }
+      if ( factors_as_string && Rf_isFactor( vec ) ) {
+        col.levels = Rf_getAttrib( vec, R_LevelsSymbol );
+        if ( all_rows ) {
+          col.factor_levels.reset( new jsonify::factors::levels( col.levels ) );
+          col.write = write_factor< Writer >;
+        } else {
+          col.write = write_factor_uncached< Writer >;
+        }
+      } else {
+        col.write = ( all_rows && !has_na( vec ) ) ? write_integer_no_na< Writer > : write_integer< Writer >;
+      }
+      break;
+    }
+    case REALSXP: {
+      col.real_data = REAL( vec );
+      col.write = date_writer< Writer >( vec, numeric_dates );
+      if ( col.write != NULL ) {
+        break;
+      }
+      bool no_na = all_rows && !has_na( vec );
+      if ( digits >= 0 ) {
+        col.write = no_na ? write_real_no_na< Writer, true > : write_real< Writer, true >;
+      } else {
+        col.write = no_na ? write_real_no_na< Writer, false > : write_real< Writer, false >;
+      }
+      break;
+    }
+    case STRSXP: {
+      if ( jsonify::utils::is_json( vec ) ) {
+        col.write = write_json< Writer >;
+      } else if ( all_rows && Rf_xlength( vec ) >= jsonify::writers::strings::MIN_CACHE_ROWS ) {
+        col.string_cache.reset( new jsonify::writers::strings::cache() );
+        col.write = write_string_cached< Writer >;
+      } else {
+        col.write = write_string< Writer >;
+      }
+      break;
+    }
+    }
+    return col;
+  }
+
+  /*
+   * A data.frame with fewer rows than this (e.g. one nested in each cell of a
+   * list column) is planned without scanning its columns for NAs, or caching
+   * its factor levels and strings, as that costs more than it saves
+   */
+  const int MIN_SCANNED_ROWS = 100;
+
+  /*
+   * all_rows - when only a single row is going to be written (e.g. a data.frame
+   * inside a data.frame) it isn't worth scanning each column for NAs, or
+   * escaping all the levels of a factor
+   */
+  template< typename Writer >
+  inline std::vector< column< Writer > > data_frame_plan(
+      SEXP df,
+      const jsonify::utils::selection& cols,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      bool all_rows = true
+    ) {
+
+    int i;
+    int n_cols = cols.size();
+    SEXP names = Rf_getAttrib( df, R_NamesSymbol );
+    bool has_names = !Rf_isNull( names );
+
+    std::vector< column< Writer > > plan;
+    plan.reserve( n_cols );
+
+    for ( i = 0; i < n_cols; i++ ) {
+      const char* name = has_names ? CHAR( STRING_ELT( names, cols[i] ) ) : "";
+      plan.push_back(
+        column_plan< Writer >( name, VECTOR_ELT( df, cols[i] ), digits, numeric_dates, factors_as_string, all_rows )
+      );
+    }
+    return plan;
+  }
+
+  template< typename Writer >
+  inline std::vector< column< Writer > > data_frame_plan(
+      SEXP df,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      bool all_rows = true
+    ) {
+    return data_frame_plan< Writer >(
+      df, jsonify::utils::select_all( Rf_length( df ) ), digits, numeric_dates, factors_as_string, all_rows
+    );
+  }
+
+  /*
+   * Prepares a plan so its cell-writers don't use the R API, and can be called
+   * from threads other than R's main thread. Returns false if a column can't
+   * be written without R (lists, data.frames and other types)
+   */
+  template< typename Writer >
+  inline bool extract( std::vector< column< Writer > >& plan ) {
+    size_t i;
+    R_xlen_t j;
+    for ( i = 0; i < plan.size(); i++ ) {
+      column< Writer >& col = plan[i];
+      if ( col.write == NULL || col.write == write_factor_uncached< Writer > || TYPEOF( col.vec ) == VECSXP ) {
+        return false;
+      }
+      bool is_json = col.write == write_json< Writer >;
+      if ( is_json || col.write == write_string< Writer > || col.write == write_string_cached< Writer > ) {
+        R_xlen_t n = Rf_xlength( col.vec );
+        col.strings.reset( new std::vector< const char* >( n ) );
+        col.string_lengths.reset( new std::vector< int >( n ) );
+        std::vector< const char* >& strings = *col.strings;
+        std::vector< int >& lengths = *col.string_lengths;
+        for ( j = 0; j < n; j++ ) {
+          SEXP s = STRING_ELT( col.vec, j );
+          strings[j] = s == NA_STRING ? NULL : CHAR( s );
+          lengths[j] = s == NA_STRING ? 0 : LENGTH( s );
+        }
+        col.string_cache.reset();
+        col.write = is_json ? write_json_extracted< Writer > : write_string_extracted< Writer >;
+      }
+    }
+    return true;
+  }
+
+} // namespace plan
+} // namespace writers
+} // namespace jsonify
+
+#endif
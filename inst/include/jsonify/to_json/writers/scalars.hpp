@@ -1,6 +1,17 @@
 #ifndef JSONIFY_WRITERS_SCALARS_H
 #define JSONIFY_WRITERS_SCALARS_H
 
+#include <Rcpp.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "jsonify/to_json/writers/escape.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
 
 namespace jsonify {
 namespace writers {
@@ -9,11 +20,171 @@ namespace scalars {
   // ---------------------------------------------------------------------------
   // scalar values
   // ---------------------------------------------------------------------------
+  /*
+   * copies a string, with its quotes, into the stream in one piece
+   */
+  template< typename Stream >
+  inline void put_string( Stream& os, const char* value, size_t length ) {
+    size_t i;
+    rapidjson::PutReserve( os, length + 2 );
+    rapidjson::PutUnsafe( os, '"' );
+    for ( i = 0; i < length; i++ ) {
+      rapidjson::PutUnsafe( os, value[i] );
+    }
+    rapidjson::PutUnsafe( os, '"' );
+  }
+
+  template< typename Encoding, typename Allocator >
+  inline void put_string( rapidjson::GenericStringBuffer< Encoding, Allocator >& os, const char* value, size_t length ) {
+    char* p = os.Push( length + 2 );
+    p[0] = '"';
+    std::memcpy( p + 1, value, length );
+    p[ length + 1 ] = '"';
+  }
+
+  /*
+   * Whether a string without characters to escape can be copied straight into
+   * the writer's output stream. Only a plain rapidjson::Writer, writing UTF-8
+   * as UTF-8 without validating it, writes such a string byte for byte. Any
+   * other writer (e.g. a PrettyWriter, which writes its own prefix, or one 
+   * which validates or transcodes) writes its strings with String()
+   */
+  template< typename Writer >
+  struct is_plain_writer {
+    static const bool value = false;
+  };
+
+  template< typename OutputStream, typename StackAllocator >
+  struct is_plain_writer< 
+    rapidjson::Writer< OutputStream, rapidjson::UTF8<>, rapidjson::UTF8<>, StackAllocator, rapidjson::kWriteDefaultFlags > 
+  > {
+    static const bool value = true;
+    typedef rapidjson::Writer< 
+      OutputStream, rapidjson::UTF8<>, rapidjson::UTF8<>, StackAllocator, rapidjson::kWriteDefaultFlags 
+    > type;
+  };
+
+  template< typename Writer, bool Plain = is_plain_writer< Writer >::value >
+  struct plain_string {
+    static void write( Writer& writer, const char* value, size_t length ) {
+      writer.String( value, static_cast< rapidjson::SizeType >( length ) );
+    }
+  };
+
+  /*
+   * Writes a string without characters to escape straight into the writer's
+   * output stream, rather than escaping it byte by byte or copying it into a
+   * quoted buffer for RawValue(). 
+   * 
+   * The stream and Prefix() (which writes any comma or colon) are protected 
+   * members of rapidjson::Writer, reached through pointers to the members of 
+   * this derived class, so it's only used for that exact type. Writers which 
+   * count values differently specialise plain_string (see stats.hpp)
+   */
+  template< typename Writer >
+  struct plain_string< Writer, true > : Writer {
+    static void write( Writer& writer, const char* value, size_t length ) {
+      if ( jsonify::writers::escape::needs_escaping( value, length ) ) {
+        writer.String( value, static_cast< rapidjson::SizeType >( length ) );
+      } else {
+        put( writer, value, length );
+      }
+    }
+
+    // 'value' must not need escaping
+    static void put( Writer& writer, const char* value, size_t length ) {
+      static_assert( 
+        std::is_same< Writer, typename is_plain_writer< Writer >::type >::value,
+        "jsonify - strings can only be copied into the stream of a rapidjson::Writer" 
+      );
+      ( writer.*( &plain_string::Prefix ) )( rapidjson::kStringType );
+      put_string( *( writer.*( &plain_string::os_ ) ), value, length );
+      if ( writer.IsComplete() ) {
+        // the string is the whole document
+        ( writer.*( &plain_string::os_ ) ) -> Flush();
+      }
+    }
+  };
+
+  template <typename Writer>
+  inline void write_value( Writer& writer, const char* value, size_t length ) {
+    plain_string< Writer >::write( writer, value, length );
+  }
+
   template <typename Writer>
   inline void write_value( Writer& writer, const char* value ) {
-    writer.String( value );
+    write_value( writer, value, std::strlen( value ) );
+  }
+
+  /*
+   * a (non-NA) CHARSXP, using its length rather than searching for the end
+   */
+  template <typename Writer>
+  inline void write_string( Writer& writer, SEXP s ) {
+    write_value( writer, CHAR( s ), static_cast< size_t >( LENGTH( s ) ) );
   }
   
+  // ---------------------------------------------------------------------------
+  // JSON
+  // ---------------------------------------------------------------------------
+  inline bool is_json_space( char c ) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  /*
+   * the type of a JSON value, from its first non-space character. The value
+   * isn't checked, so "nope" is kNullType
+   * 
+   * returns false if there is nothing but whitespace
+   */
+  inline bool json_type( const char* json, size_t length, rapidjson::Type& type ) {
+    size_t i = 0;
+    while ( i < length && is_json_space( json[i] ) ) {
+      i++;
+    }
+    if ( i == length ) {
+      return false;
+    }
+    switch( json[i] ) {
+    case '{': type = rapidjson::kObjectType; break;
+    case '[': type = rapidjson::kArrayType; break;
+    case '"': type = rapidjson::kStringType; break;
+    case 't': type = rapidjson::kTrueType; break;
+    case 'f': type = rapidjson::kFalseType; break;
+    case 'n': type = rapidjson::kNullType; break;
+    default: type = rapidjson::kNumberType;
+    }
+    return true;
+  }
+
+  /*
+   * JSON which has already been written (e.g. by to_json()) is copied into
+   * the output as it is, without being parsed or escaped. It isn't validated
+   * either, but as it's copied whole validating the output will find any
+   * errors. A NULL (NA) or blank string is written as null
+   */
+  template <typename Writer>
+  inline void write_json( Writer& writer, const char* json, size_t length ) {
+    rapidjson::Type type;
+    if ( json == NULL || !json_type( json, length, type ) ) {
+      writer.Null();
+    } else {
+      writer.RawValue( json, length, type );
+    }
+  }
+
+  /*
+   * a CHARSXP of JSON
+   */
+  template <typename Writer>
+  inline void write_json( Writer& writer, SEXP s ) {
+    if ( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      write_json( writer, CHAR( s ), static_cast< size_t >( LENGTH( s ) ) );
+    }
+  }
+
   template <typename Writer>
   inline void write_value( Writer& writer, int& value ) {
     if( std::isnan( value ) ) {
@@ -23,8 +194,94 @@ namespace scalars {
     }
   }
   
+  // ---------------------------------------------------------------------------
+  // fixed-precision doubles
+  // ---------------------------------------------------------------------------
+  
+  /*
+   * Beyond 6 digits a small value could need an exponent, and beyond 1e15 a 
+   * value may not have a unique representation with the digits requested. 
+   * These are left to writer.Double()
+   */
+  const int MAX_FIXED_DIGITS = 6;
+  const double MAX_FIXED_SCALED = 1e15;
+  
+  inline double power_of_ten( int digits ) {
+    return digits >= 0 ? std::pow( 10.0, digits ) : 1.0;
+  }
+  
+  /*
+   * writes 'value' rounded to 'digits' decimal places from its integer-scaled
+   * value, dropping trailing zeros but keeping at least one decimal place (e.g. 
+   * "1.0"), the same as writer.Double() writes the rounded value.
+   * 
+   * scale - power_of_ten( digits )
+   * returns false, having written nothing, if the value isn't suitable
+   */
   template <typename Writer>
-  inline void write_value( Writer& writer, double& value, int digits ) {
+  inline bool write_fixed( Writer& writer, double value, int digits, double scale ) {
+    
+    if ( digits > MAX_FIXED_DIGITS ) {
+      return false;
+    }
+    double scaled = round( value * scale );
+    if ( !( std::fabs( scaled ) < MAX_FIXED_SCALED ) ) {
+      return false;
+    }
+    
+    char buf[ 32 ];
+    char digit_buf[ 24 ];
+    char* p = buf;
+    int n = 0;
+    
+    long long r = static_cast< long long >( scaled );
+    if ( r < 0 || ( r == 0 && std::signbit( value ) ) ) {
+      *p++ = '-';
+      r = -r;
+    }
+    
+    long long p10 = static_cast< long long >( scale );
+    long long int_part = r / p10;
+    long long frac_part = r % p10;
+    
+    do {
+      digit_buf[ n++ ] = static_cast< char >( '0' + int_part % 10 );
+      int_part /= 10;
+    } while ( int_part > 0 );
+    while ( n > 0 ) {
+      *p++ = digit_buf[ --n ];
+    }
+    
+    *p++ = '.';
+    if ( frac_part == 0 ) {
+      *p++ = '0';
+    } else {
+      int width = digits;
+      while ( frac_part % 10 == 0 ) {
+        frac_part /= 10;
+        width--;
+      }
+      for ( n = width - 1; n >= 0; n-- ) {
+        p[ n ] = static_cast< char >( '0' + frac_part % 10 );
+        frac_part /= 10;
+      }
+      p += width;
+    }
+    
+    writer.RawValue( buf, p - buf, rapidjson::kNumberType );
+    return true;
+  }
+  
+  /*
+   * Rounded - whether digits >= 0. Writers of many values (a vector, matrix or
+   * data.frame column) choose this once, so the value loop doesn't test 'digits'
+   * 
+   * scale - power_of_ten( digits ), so it can be calculated once for a vector
+   * 
+   * 'value' is taken by value so rounding never writes back to the R object 
+   */
+  template < bool Rounded, typename Writer >
+  inline void write_double( Writer& writer, double value, int digits, double scale ) {
     
     if(std::isnan( value ) ) {
       writer.Null();
@@ -38,16 +295,30 @@ namespace scalars {
         str[0] = toupper(str[0]);
       }
       writer.String( str.c_str() );
-    } else {
-      
-      if ( digits >= 0 ) {
-        double e = std::pow( 10.0, digits );
-        value = round( value * e ) / e;
+    } else if ( Rounded ) {
+      if ( write_fixed( writer, value, digits, scale ) ) {
+        return;
       }
+      writer.Double( round( value * scale ) / scale );
+    } else {
       writer.Double( value );
     }
   }
   
+  template <typename Writer>
+  inline void write_value( Writer& writer, double value, int digits, double scale ) {
+    if ( digits >= 0 ) {
+      write_double< true >( writer, value, digits, scale );
+    } else {
+      write_double< false >( writer, value, digits, scale );
+    }
+  }
+  
+  template <typename Writer>
+  inline void write_value( Writer& writer, double value, int digits ) {
+    write_value( writer, value, digits, power_of_ten( digits ) );
+  }
+  
   template< typename Writer> 
   inline void write_value( Writer& writer, bool& value ) {
     writer.Bool( value );
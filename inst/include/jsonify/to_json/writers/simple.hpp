@@ -3,7 +3,10 @@
 
 #include <Rcpp.h>
 #include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/dates/dates.hpp"
+#include "jsonify/to_json/factors/factors.hpp"
 #include "jsonify/to_json/writers/scalars.hpp"
+#include "jsonify/to_json/writers/strings.hpp"
 
 using namespace rapidjson;
 
@@ -22,11 +25,24 @@ namespace simple {
     bool will_unbox = jsonify::utils::should_unbox( n, unbox );
     jsonify::utils::start_array( writer, will_unbox );
     
-    for ( int i = 0; i < n; i++ ) {
-      if (Rcpp::StringVector::is_na( sv[i] ) ) {
-        writer.Null();
-      } else{
-        jsonify::writers::scalars::write_value( writer, sv[i] );
+    if ( n >= jsonify::writers::strings::MIN_CACHE_ROWS ) {
+      jsonify::writers::strings::cache cache;
+      for ( int i = 0; i < n; i++ ) {
+        SEXP s = STRING_ELT( sv, i );
+        if ( s == NA_STRING ) {
+          writer.Null();
+        } else {
+          cache.write( writer, s );
+        }
+      }
+    } else {
+      for ( int i = 0; i < n; i++ ) {
+        SEXP s = STRING_ELT( sv, i );
+        if ( s == NA_STRING ) {
+          writer.Null();
+        } else{
+          jsonify::writers::scalars::write_string( writer, s );
+        }
       }
     }
     jsonify::utils::end_array( writer, will_unbox );
@@ -38,11 +54,44 @@ namespace simple {
   template <typename Writer >
   inline void write_value( Writer& writer, Rcpp::StringVector& sv, int row ) {
     
-    if ( Rcpp::StringVector::is_na( sv[ row ] ) ) {
+    SEXP s = STRING_ELT( sv, row );
+    if ( s == NA_STRING ) {
       writer.Null();
     } else {
-      const char *s = sv[ row ];
-      jsonify::writers::scalars::write_value( writer, s );
+      jsonify::writers::scalars::write_string( writer, s );
+    }
+  }
+
+  /*
+   * a vector of class "json" is copied rather than escaped. A single document
+   * (e.g. from to_json()) is embedded as it is, whatever 'unbox' is, and 
+   * several are the values of an array
+   */
+  template <typename Writer>
+  inline void write_json( Writer& writer, SEXP json ) {
+    R_xlen_t i;
+    R_xlen_t n = Rf_xlength( json );
+    bool will_unbox = jsonify::utils::should_unbox_json( n );
+    jsonify::utils::start_array( writer, will_unbox );
+    for ( i = 0; i < n; i++ ) {
+      jsonify::writers::scalars::write_json( writer, STRING_ELT( json, i ) );
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+
+  template <typename Writer>
+  inline void write_json( Writer& writer, SEXP json, int row ) {
+    jsonify::writers::scalars::write_json( writer, STRING_ELT( json, row ) );
+  }
+  
+  /*
+   * Rounded - whether digits >= 0, chosen once for the vector. NaN and NA 
+   * are null
+   */
+  template< bool Rounded, typename Writer >
+  inline void write_numbers( Writer& writer, const double* values, int n, int digits, double scale ) {
+    for ( int i = 0; i < n; i++ ) {
+      jsonify::writers::scalars::write_double< Rounded >( writer, values[i], digits, scale );
     }
   }
   
@@ -50,33 +99,39 @@ namespace simple {
   inline void write_value( Writer& writer, Rcpp::NumericVector& nv, bool unbox, 
                            int digits, bool numeric_dates ) {
 
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( nv );
-    
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
+    if( !numeric_dates && Rf_inherits( nv, "Date" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( nv );
-      write_value( writer, sv, unbox );
+      int n = nv.size();
+      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      jsonify::utils::start_array( writer, will_unbox );
+      for ( int i = 0; i < n; i++ ) {
+        jsonify::dates::write_date( writer, nv[i] );
+      }
+      jsonify::utils::end_array( writer, will_unbox );
       
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+    } else if ( !numeric_dates && Rf_inherits( nv, "POSIXt" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( nv );
-      write_value( writer, sv, unbox );
+      int n = nv.size();
+      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      jsonify::utils::start_array( writer, will_unbox );
+      for ( int i = 0; i < n; i++ ) {
+        jsonify::dates::write_posixct( writer, nv[i] );
+      }
+      jsonify::utils::end_array( writer, will_unbox );
       
     } else {
     
       int n = nv.size();
       bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      double scale = jsonify::writers::scalars::power_of_ten( digits );
       
       jsonify::utils::start_array( writer, will_unbox );
-    
-      for ( int i = 0; i < n; i++ ) {
-        if( Rcpp::NumericVector::is_na( nv[i] ) ) {
-          writer.Null();
-        } else {
-          jsonify::writers::scalars::write_value( writer, nv[i], digits );
-        }
+      if ( digits >= 0 ) {
+        write_numbers< true >( writer, REAL( nv ), n, digits, scale );
+      } else {
+        write_numbers< false >( writer, REAL( nv ), n, digits, scale );
       }
-    jsonify::utils::end_array( writer, will_unbox );
+      jsonify::utils::end_array( writer, will_unbox );
     }
   }
   
@@ -87,17 +142,13 @@ namespace simple {
   inline void write_value( Writer& writer, Rcpp::NumericVector& nv, 
                            int row, int digits, bool numeric_dates ) {
 
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( nv );
-    
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
+    if( !numeric_dates && Rf_inherits( nv, "Date" ) ) {
 
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_date( writer, nv[ row ] );
       
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+    } else if ( !numeric_dates && Rf_inherits( nv, "POSIXt" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_posixct( writer, nv[ row ] );
       
     } else {
       if ( Rcpp::NumericVector::is_na( nv[ row ] ) ) {
@@ -118,31 +169,41 @@ namespace simple {
       bool factors_as_string
     ) {
     
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( iv );
-
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
+    if( !numeric_dates && Rf_inherits( iv, "Date" ) ) {
 
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( iv );
-      write_value( writer, sv, unbox );
+      int n = iv.size();
+      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      jsonify::utils::start_array( writer, will_unbox );
+      for ( int i = 0; i < n; i++ ) {
+        jsonify::dates::write_date( writer, iv[i] );
+      }
+      jsonify::utils::end_array( writer, will_unbox );
       
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+    } else if ( !numeric_dates && Rf_inherits( iv, "POSIXt" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( iv );
-      write_value( writer, sv, unbox );
+      int n = iv.size();
+      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      jsonify::utils::start_array( writer, will_unbox );
+      for ( int i = 0; i < n; i++ ) {
+        jsonify::dates::write_posixct( writer, iv[i] );
+      }
+      jsonify::utils::end_array( writer, will_unbox );
       
     } else if ( factors_as_string && Rf_isFactor( iv ) ) {
       
-      Rcpp::CharacterVector lvls = iv.attr( "levels" );
-      if (lvls.length() == 0 ) {
+      SEXP lvls = Rf_getAttrib( iv, R_LevelsSymbol );
+      if ( Rf_length( lvls ) == 0 ) {
         // no levels - from NA_character_ vector
-        Rcpp::StringVector s(1);
-        s[0] = NA_STRING;
-        int ele = 0;
-        write_value( writer, s, ele );
+        writer.Null();
       } else {
-        Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-        write_value( writer, str, unbox );
-        //write_value( writer, lvls, unbox );
+        jsonify::factors::levels factor_levels( lvls );
+        int n = iv.size();
+        bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+        jsonify::utils::start_array( writer, will_unbox );
+        for ( int i = 0; i < n; i++ ) {
+          factor_levels.write( writer, iv[i] );
+        }
+        jsonify::utils::end_array( writer, will_unbox );
       }
       
     } else {
@@ -175,30 +236,22 @@ namespace simple {
       bool factors_as_string
     ) {
     
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( iv );
-    
-    
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
+    if( !numeric_dates && Rf_inherits( iv, "Date" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( iv );
-      write_value( writer, sv, row );
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+      jsonify::dates::write_date( writer, iv[ row ] );
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( iv );
-      write_value( writer, sv, row );
+    } else if ( !numeric_dates && Rf_inherits( iv, "POSIXt" ) ) {
+      
+      jsonify::dates::write_posixct( writer, iv[ row ] );
       
     } else if ( factors_as_string && Rf_isFactor( iv ) ) {
       
-      Rcpp::StringVector lvls = iv.attr( "levels" );
-      if (lvls.length() == 0 ) {
-        // no level s- from NA_character_ vector
-        Rcpp::StringVector s(1);
-        s[0] = NA_STRING;
-        int ele = 0;
-        write_value( writer, s, ele );
+      SEXP lvls = Rf_getAttrib( iv, R_LevelsSymbol );
+      if ( Rf_length( lvls ) == 0 ) {
+        // no levels - from NA_character_ vector
+        writer.Null();
       } else {
-        Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-        write_value( writer, str, row );
+        jsonify::factors::write_value( writer, lvls, iv[ row ] );
       }
       
     } else {
@@ -344,55 +397,146 @@ namespace simple {
   // matrix values
   // ---------------------------------------------------------------------------
   
-  template < typename Writer >
-  inline void write_value(
-      Writer& writer, 
-      Rcpp::IntegerMatrix& mat, 
-      bool unbox = false,
-      std::string by = "row"
+  /*
+   * Matrices are read straight from their (column-major) data, rather than 
+   * copying each row or column into a new vector
+   * 
+   * The cell-writers write the value at 'idx' of the matrix's data
+   */
+  struct integer_cells {
+    const int* data;
+    template< typename Writer >
+    inline void operator()( Writer& writer, R_xlen_t idx ) const {
+      int value = data[ idx ];
+      if ( value == NA_INTEGER ) {
+        writer.Null();
+      } else {
+        writer.Int( value );
+      }
+    }
+  };
+  
+  struct logical_cells {
+    const int* data;
+    template< typename Writer >
+    inline void operator()( Writer& writer, R_xlen_t idx ) const {
+      int value = data[ idx ];
+      if ( value == NA_LOGICAL ) {
+        writer.Null();
+      } else {
+        writer.Bool( value != 0 );
+      }
+    }
+  };
+  
+  // Rounded - whether digits >= 0, chosen once for the matrix
+  template< bool Rounded >
+  struct numeric_cells {
+    const double* data;
+    int digits;
+    double scale;
+    
+    numeric_cells( const double* data, int digits ) : 
+      data( data ), digits( digits ), scale( jsonify::writers::scalars::power_of_ten( digits ) ) {}
+    
+    template< typename Writer >
+    inline void operator()( Writer& writer, R_xlen_t idx ) const {
+      jsonify::writers::scalars::write_double< Rounded >( writer, data[ idx ], digits, scale );
+    }
+  };
+  
+  struct string_cells {
+    SEXP mat;
+    template< typename Writer >
+    inline void operator()( Writer& writer, R_xlen_t idx ) const {
+      SEXP s = STRING_ELT( mat, idx );
+      if ( s == NA_STRING ) {
+        writer.Null();
+      } else {
+        jsonify::writers::scalars::write_string( writer, s );
+      }
+    }
+  };
+  
+  /*
+   * writes an array of rows (or columns), each of which is an array
+   */
+  template < typename Writer, typename Cells >
+  inline void write_matrix(
+      Writer& writer,
+      const Cells& cells,
+      int n_row,
+      int n_col,
+      bool unbox,
+      jsonify::utils::by_type by
   ) {
     
     bool will_unbox = false;
     jsonify::utils::start_array( writer, will_unbox );
-    int n;
     int i;
+    int j;
     
-    if ( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; i++ ) {
-        Rcpp::IntegerVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox, true, true );  // true, true : numeric_dates, factors_as_string
+    if ( by == jsonify::utils::BY_ROW ) {
+      bool unbox_row = jsonify::utils::should_unbox( n_col, unbox );
+      for ( i = 0; i < n_row; i++ ) {
+        jsonify::utils::start_array( writer, unbox_row );
+        R_xlen_t idx = i;
+        for ( j = 0; j < n_col; j++, idx += n_row ) {
+          cells( writer, idx );
+        }
+        jsonify::utils::end_array( writer, unbox_row );
       }
-    } else { // by == "column"
-      n = mat.ncol();
-      for( i = 0; i < n; i++ ) {
-        Rcpp::IntegerVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox, true, true ); // true, true : numeric_dates, factors_as_string
+    } else { // by == jsonify::utils::BY_COLUMN
+      bool unbox_col = jsonify::utils::should_unbox( n_row, unbox );
+      for ( j = 0; j < n_col; j++ ) {
+        jsonify::utils::start_array( writer, unbox_col );
+        R_xlen_t idx = static_cast< R_xlen_t >( j ) * n_row;
+        for ( i = 0; i < n_row; i++, idx++ ) {
+          cells( writer, idx );
+        }
+        jsonify::utils::end_array( writer, unbox_col );
       }
     }
     jsonify::utils::end_array( writer, will_unbox );
   }
   
-  template < typename Writer >
-  inline void write_value( Writer& writer, Rcpp::NumericMatrix& mat, bool unbox = false, 
-                           int digits = -1, std::string by = "row" ) {
+  /*
+   * writes the selected rows and columns of a matrix, in the order selected
+   */
+  template < typename Writer, typename Cells >
+  inline void write_matrix(
+      Writer& writer,
+      const Cells& cells,
+      int n_row,
+      const jsonify::utils::selection& rows,
+      const jsonify::utils::selection& cols,
+      bool unbox,
+      jsonify::utils::by_type by
+  ) {
     
     bool will_unbox = false;
     jsonify::utils::start_array( writer, will_unbox );
-    
-    int n;
     int i;
-    if ( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; i++ ) {
-        Rcpp::NumericVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox, digits, true );  // true : numeric dates
+    int j;
+    
+    if ( by == jsonify::utils::BY_ROW ) {
+      bool unbox_row = jsonify::utils::should_unbox( cols.size(), unbox );
+      for ( i = 0; i < rows.size(); i++ ) {
+        jsonify::utils::start_array( writer, unbox_row );
+        for ( j = 0; j < cols.size(); j++ ) {
+          cells( writer, static_cast< R_xlen_t >( cols[j] ) * n_row + rows[i] );
+        }
+        jsonify::utils::end_array( writer, unbox_row );
       }
-    } else { // by == "column"
-      n = mat.ncol();
-      for( i = 0; i < n; i++ ) {
-        Rcpp::NumericVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox, digits, true );  // true : numeric dates
+    } else { // by == jsonify::utils::BY_COLUMN
+      bool unbox_col = jsonify::utils::should_unbox( rows.size(), unbox );
+      for ( j = 0; j < cols.size(); j++ ) {
+        jsonify::utils::start_array( writer, unbox_col );
+        R_xlen_t offset = static_cast< R_xlen_t >( cols[j] ) * n_row;
+        for ( i = 0; i < rows.size(); i++ ) {
+          cells( writer, offset + rows[i] );
+        }
+        jsonify::utils::end_array( writer, unbox_col );
       }
     }
     jsonify::utils::end_array( writer, will_unbox );
@@ -400,63 +544,111 @@ namespace simple {
   
   template < typename Writer >
   inline void write_value(
-      Writer& writer, 
-      Rcpp::CharacterMatrix& mat, 
-      bool unbox = false, 
-      std::string by = "row"
+      Writer& writer,
+      SEXP mat,
+      const jsonify::utils::selection& rows,
+      const jsonify::utils::selection& cols,
+      bool unbox,
+      int digits,
+      jsonify::utils::by_type by
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    int i;
-    int n;
-    
-    if( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; i++ ) {
-        Rcpp::StringVector this_row = mat( i, Rcpp::_ );
-        write_value( writer, this_row, unbox );
-      }
-    } else { // by == column
-      n = mat.ncol();
-      for ( i = 0; i < n; i++ ) {
-        Rcpp::StringVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox );
+    int n_row = Rf_nrows( mat );
+    switch( TYPEOF( mat ) ) {
+    case REALSXP: {
+      if ( digits >= 0 ) {
+        write_matrix( writer, numeric_cells< true >( REAL( mat ), digits ), n_row, rows, cols, unbox, by );
+      } else {
+        write_matrix( writer, numeric_cells< false >( REAL( mat ), digits ), n_row, rows, cols, unbox, by );
       }
+      break;
     }
-    jsonify::utils::end_array( writer, will_unbox );
+    case INTSXP: {
+      integer_cells cells;
+      cells.data = INTEGER( mat );
+      write_matrix( writer, cells, n_row, rows, cols, unbox, by );
+      break;
+    }
+    case LGLSXP: {
+      logical_cells cells;
+      cells.data = LOGICAL( mat );
+      write_matrix( writer, cells, n_row, rows, cols, unbox, by );
+      break;
+    }
+    default: {
+      Rcpp::StringMatrix sm = Rcpp::as< Rcpp::StringMatrix >( mat );
+      string_cells cells;
+      cells.mat = sm;
+      write_matrix( writer, cells, n_row, rows, cols, unbox, by );
+      break;
+    }
+    }
+  }
+  
+  template < typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::IntegerMatrix& mat, 
+      bool unbox = false,
+      jsonify::utils::by_type by = jsonify::utils::BY_ROW
+  ) {
+    integer_cells cells;
+    cells.data = INTEGER( mat );
+    write_matrix( writer, cells, mat.nrow(), mat.ncol(), unbox, by );
   }
   
+  template < typename Writer >
+  inline void write_value( Writer& writer, Rcpp::NumericMatrix& mat, bool unbox = false, 
+                           int digits = -1, jsonify::utils::by_type by = jsonify::utils::BY_ROW ) {
+    if ( digits >= 0 ) {
+      write_matrix( writer, numeric_cells< true >( REAL( mat ), digits ), mat.nrow(), mat.ncol(), unbox, by );
+    } else {
+      write_matrix( writer, numeric_cells< false >( REAL( mat ), digits ), mat.nrow(), mat.ncol(), unbox, by );
+    }
+  }
+  
+  template < typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::CharacterMatrix& mat, 
+      bool unbox = false, 
+      jsonify::utils::by_type by = jsonify::utils::BY_ROW
+  ) {
+    string_cells cells;
+    cells.mat = mat;
+    write_matrix( writer, cells, mat.nrow(), mat.ncol(), unbox, by );
+  }
   
   template < typename Writer >
   inline void write_value(
       Writer& writer, 
       Rcpp::LogicalMatrix& mat, 
       bool unbox = false, 
-      std::string by = "row"
+      jsonify::utils::by_type by = jsonify::utils::BY_ROW
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    int i;
-    int n;
-    
-    if( by == "row" ) {
-      n = mat.nrow();
-      
-      for ( i = 0; i < n; i++ ) {
-        Rcpp::LogicalVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox );
-      }
-    } else { // by == "column;
-      n = mat.ncol();
-      
-      for( i = 0; i < n; i++ ) {
-        Rcpp::LogicalVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox);
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
+    logical_cells cells;
+    cells.data = LOGICAL( mat );
+    write_matrix( writer, cells, mat.nrow(), mat.ncol(), unbox, by );
+  }
+
+  // for callers passing 'by' as "row" or "column"
+  template < typename Writer >
+  inline void write_value( Writer& writer, Rcpp::IntegerMatrix& mat, bool unbox, const std::string& by ) {
+    write_value( writer, mat, unbox, jsonify::utils::to_by( by ) );
+  }
+
+  template < typename Writer >
+  inline void write_value( Writer& writer, Rcpp::NumericMatrix& mat, bool unbox, int digits, const std::string& by ) {
+    write_value( writer, mat, unbox, digits, jsonify::utils::to_by( by ) );
+  }
+
+  template < typename Writer >
+  inline void write_value( Writer& writer, Rcpp::CharacterMatrix& mat, bool unbox, const std::string& by ) {
+    write_value( writer, mat, unbox, jsonify::utils::to_by( by ) );
+  }
+
+  template < typename Writer >
+  inline void write_value( Writer& writer, Rcpp::LogicalMatrix& mat, bool unbox, const std::string& by ) {
+    write_value( writer, mat, unbox, jsonify::utils::to_by( by ) );
   }
 
 } // namespace simple
@@ -0,0 +1,104 @@
+#ifndef R_JSONIFY_WRITERS_STRINGS_H
+#define R_JSONIFY_WRITERS_STRINGS_H
+
+#include <Rcpp.h>
+#include <string>
+#include <unordered_map>
+#include "jsonify/to_json/writers/scalars.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace jsonify {
+namespace writers {
+namespace strings {
+
+  /*
+   * R keeps one CHARSXP for each distinct string, so a long character vector
+   * often has only a few distinct CHARSXPs. The cache keeps the escaped JSON
+   * of each, keyed by its address, so a repeated string is copied into the
+   * JSON rather than scanned and escaped again.
+   *
+   * Short strings are quicker to write than to look up, so they aren't cached.
+   * The cache stops growing once it holds MAX_CACHE_BYTES, and turns itself off
+   * if, after CHECK_AFTER strings, most have been different (e.g. ids)
+   */
+  const R_xlen_t MIN_CACHE_ROWS = 1000;
+  const int MIN_CACHED_LENGTH = 16;
+  const size_t MAX_CACHE_BYTES = 4 * 1024 * 1024;
+  const size_t CHECK_AFTER = 1000;
+
+  class cache {
+  public:
+
+    cache() : escaper( sb ), lookups( 0 ), misses( 0 ), enabled( true ) {}
+
+    /*
+     * s - a non-NA CHARSXP
+     */
+    template< typename Writer >
+    inline void write( Writer& writer, SEXP s ) {
+      if ( !enabled || LENGTH( s ) < MIN_CACHED_LENGTH ) {
+        jsonify::writers::scalars::write_string( writer, s );
+        return;
+      }
+
+      lookups++;
+      std::unordered_map< SEXP, entry >::const_iterator it = index.find( s );
+      if ( it != index.end() ) {
+        writer.RawValue( json.data() + it -> second.offset, it -> second.length, rapidjson::kStringType );
+        return;
+      }
+
+      misses++;
+      if ( lookups >= CHECK_AFTER && misses * 2 > lookups ) {
+        disable();
+      }
+      if ( !enabled || json.size() + LENGTH( s ) > MAX_CACHE_BYTES ) {
+        jsonify::writers::scalars::write_string( writer, s );
+        return;
+      }
+
+      sb.Clear();
+      escaper.Reset( sb );
+      jsonify::writers::scalars::write_string( escaper, s );
+
+      entry e;
+      e.offset = json.size();
+      e.length = sb.GetSize();
+      json.append( sb.GetString(), sb.GetSize() );
+      index[ s ] = e;
+      writer.RawValue( json.data() + e.offset, e.length, rapidjson::kStringType );
+    }
+
+  private:
+    struct entry {
+      size_t offset;
+      size_t length;
+    };
+
+    cache( const cache& );
+    cache& operator=( const cache& );
+
+    void disable() {
+      enabled = false;
+      index.clear();
+      std::string().swap( json );
+    }
+
+    std::unordered_map< SEXP, entry > index;
+    std::string json;
+    rapidjson::StringBuffer sb;
+    rapidjson::Writer< rapidjson::StringBuffer > escaper;
+    size_t lookups;
+    size_t misses;
+    bool enabled;
+  };
+
+} // namespace strings
+} // namespace writers
+} // namespace jsonify
+
+#endif
@@ -2,23 +2,89 @@
 #define R_JSONIFY_VALIDATE_H
 
 #include <Rcpp.h>
-#include "rapidjson/document.h"
+#include <thread>
+#include <vector>
+#include "jsonify/buffers/buffers.hpp"
+
+// [[Rcpp::depends(rapidjsonr)]]
+
+#include "rapidjson/reader.h"
 
 namespace jsonify {
 namespace validate {
 
-  inline bool validate_json( rapidjson::Document& d, const char* json ) {
-    d.Parse( json );
-    bool res = true;
-    if( d.Parse( json ).HasParseError() ) {
-      res = false;
-    }
-    return res;
+  // fewer strings than this per thread isn't worth starting a thread for
+  const R_xlen_t MIN_JSON_PER_THREAD = 1000;
+
+  /*
+   * parses with a handler which does nothing, so no DOM is built
+   */
+  inline bool validate_json( rapidjson::Reader& reader, const char* json ) {
+    rapidjson::BaseReaderHandler<> handler;
+    rapidjson::StringStream ss( json );
+    return !reader.Parse( ss, handler ).IsError();
   }
 
   inline bool validate_json( const char* json ) {
-    rapidjson::Document doc;
-    return validate_json( doc, json );
+    jsonify::buffers::lease lease;
+    return validate_json( lease.reader(), json );
+  }
+
+  /*
+   * validates json[ start, end ), where NULL (NA) is invalid. Must not use the R API
+   */
+  inline void validate_range(
+      const std::vector< const char* >* json,
+      int* res,
+      R_xlen_t start,
+      R_xlen_t end
+    ) {
+    R_xlen_t i;
+    jsonify::buffers::lease lease;
+    for ( i = start; i < end; i++ ) {
+      const char* js = ( *json )[i];
+      res[i] = js != NULL && validate_json( lease.reader(), js );
+    }
+  }
+
+  /*
+   * threads - the vector is split into this many chunks, each validated by 
+   * its own thread
+   */
+  inline Rcpp::LogicalVector validate_json( Rcpp::StringVector& json, int threads = 1 ) {
+
+    R_xlen_t i;
+    R_xlen_t n = json.size();
+    Rcpp::LogicalVector res( n );
+
+    // the strings are extracted here, as the threads can't use the R API
+    std::vector< const char* > js( n );
+    for ( i = 0; i < n; i++ ) {
+      SEXP s = STRING_ELT( json, i );
+      js[i] = s == NA_STRING ? NULL : CHAR( s );
+    }
+
+    R_xlen_t max_threads = n / MIN_JSON_PER_THREAD;
+    if ( threads > max_threads ) {
+      threads = static_cast< int >( max_threads );
+    }
+    if ( threads < 2 ) {
+      validate_range( &js, LOGICAL( res ), 0, n );
+      return res;
+    }
+
+    R_xlen_t chunk = ( n + threads - 1 ) / threads;
+    std::vector< std::thread > workers;
+    workers.reserve( threads );
+    for ( i = 0; i < threads; i++ ) {
+      R_xlen_t start = i * chunk;
+      R_xlen_t end = start + chunk < n ? start + chunk : n;
+      workers.push_back( std::thread( validate_range, &js, LOGICAL( res ), start, end ) );
+    }
+    for ( i = 0; i < threads; i++ ) {
+      workers[i].join();
+    }
+    return res;
   }
 
 } // namespace validate
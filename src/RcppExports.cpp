@@ -5,35 +5,70 @@
 
 using namespace Rcpp;
 
-// rcpp_pretty_json
-Rcpp::StringVector rcpp_pretty_json(const char* json);
-RcppExport SEXP _jsonify_rcpp_pretty_json(SEXP jsonSEXP) {
+// rcpp_release_buffers
+void rcpp_release_buffers();
+RcppExport SEXP _jsonify_rcpp_release_buffers() {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_release_buffers();
+    return R_NilValue;
+END_RCPP
+}
+// rcpp_json_combine
+Rcpp::StringVector rcpp_json_combine(Rcpp::StringVector json, bool validate);
+RcppExport SEXP _jsonify_rcpp_json_combine(SEXP jsonSEXP, SEXP validateSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::StringVector >::type json(jsonSEXP);
+    Rcpp::traits::input_parameter< bool >::type validate(validateSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_json_combine(json, validate));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_from_json
+SEXP rcpp_from_json(const char* json, bool simplify);
+RcppExport SEXP _jsonify_rcpp_from_json(SEXP jsonSEXP, SEXP simplifySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const char* >::type json(jsonSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_pretty_json(json));
+    Rcpp::traits::input_parameter< bool >::type simplify(simplifySEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_from_json(json, simplify));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_pretty_json
+Rcpp::StringVector rcpp_pretty_json(Rcpp::StringVector json, int indent);
+RcppExport SEXP _jsonify_rcpp_pretty_json(SEXP jsonSEXP, SEXP indentSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::StringVector >::type json(jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type indent(indentSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_pretty_json(json, indent));
     return rcpp_result_gen;
 END_RCPP
 }
 // rcpp_minify_json
-Rcpp::StringVector rcpp_minify_json(const char* json);
+Rcpp::StringVector rcpp_minify_json(Rcpp::StringVector json);
 RcppExport SEXP _jsonify_rcpp_minify_json(SEXP jsonSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const char* >::type json(jsonSEXP);
+    Rcpp::traits::input_parameter< Rcpp::StringVector >::type json(jsonSEXP);
     rcpp_result_gen = Rcpp::wrap(rcpp_minify_json(json));
     return rcpp_result_gen;
 END_RCPP
 }
 // rcpp_pretty_print
-void rcpp_pretty_print(const char* json);
-RcppExport SEXP _jsonify_rcpp_pretty_print(SEXP jsonSEXP) {
+void rcpp_pretty_print(Rcpp::StringVector json, int indent);
+RcppExport SEXP _jsonify_rcpp_pretty_print(SEXP jsonSEXP, SEXP indentSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const char* >::type json(jsonSEXP);
-    rcpp_pretty_print(json);
+    Rcpp::traits::input_parameter< Rcpp::StringVector >::type json(jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type indent(indentSEXP);
+    rcpp_pretty_print(json, indent);
     return R_NilValue;
 END_RCPP
 }
@@ -47,8 +82,59 @@ BEGIN_RCPP
 END_RCPP
 }
 // rcpp_to_json
-Rcpp::StringVector rcpp_to_json(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
-RcppExport SEXP _jsonify_rcpp_to_json(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+Rcpp::StringVector rcpp_to_json(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, int threads);
+RcppExport SEXP _jsonify_rcpp_to_json(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_json(lst, unbox, digits, numeric_dates, factors_as_string, by, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_to_json_subset
+Rcpp::StringVector rcpp_to_json_subset(SEXP x, SEXP rows, SEXP cols, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
+RcppExport SEXP _jsonify_rcpp_to_json_subset(SEXP xSEXP, SEXP rowsSEXP, SEXP colsSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type rows(rowsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type cols(colsSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_json_subset(x, rows, cols, unbox, digits, numeric_dates, factors_as_string, by));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_to_json_each
+Rcpp::StringVector rcpp_to_json_each(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
+RcppExport SEXP _jsonify_rcpp_to_json_each(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_json_each(lst, unbox, digits, numeric_dates, factors_as_string, by));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_to_json_stats
+Rcpp::List rcpp_to_json_stats(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
+RcppExport SEXP _jsonify_rcpp_to_json_stats(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -58,29 +144,88 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
     Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
     Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_to_json(lst, unbox, digits, numeric_dates, factors_as_string, by));
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_json_stats(lst, unbox, digits, numeric_dates, factors_as_string, by));
     return rcpp_result_gen;
 END_RCPP
 }
+// rcpp_to_json_file
+void rcpp_to_json_file(SEXP lst, const char* file, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
+RcppExport SEXP _jsonify_rcpp_to_json_file(SEXP lstSEXP, SEXP fileSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< const char* >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    rcpp_to_json_file(lst, file, unbox, digits, numeric_dates, factors_as_string, by);
+    return R_NilValue;
+END_RCPP
+}
+// rcpp_to_ndjson
+Rcpp::StringVector rcpp_to_ndjson(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, bool as_vector);
+RcppExport SEXP _jsonify_rcpp_to_ndjson(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP as_vectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< bool >::type as_vector(as_vectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_ndjson(lst, unbox, digits, numeric_dates, factors_as_string, by, as_vector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_to_ndjson_file
+void rcpp_to_ndjson_file(SEXP lst, const char* file, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
+RcppExport SEXP _jsonify_rcpp_to_ndjson_file(SEXP lstSEXP, SEXP fileSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< const char* >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    rcpp_to_ndjson_file(lst, file, unbox, digits, numeric_dates, factors_as_string, by);
+    return R_NilValue;
+END_RCPP
+}
 // rcpp_validate_json
-Rcpp::LogicalVector rcpp_validate_json(Rcpp::StringVector json);
-RcppExport SEXP _jsonify_rcpp_validate_json(SEXP jsonSEXP) {
+Rcpp::LogicalVector rcpp_validate_json(Rcpp::StringVector json, int threads);
+RcppExport SEXP _jsonify_rcpp_validate_json(SEXP jsonSEXP, SEXP threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< Rcpp::StringVector >::type json(jsonSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_validate_json(json));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_validate_json(json, threads));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_jsonify_rcpp_pretty_json", (DL_FUNC) &_jsonify_rcpp_pretty_json, 1},
+    {"_jsonify_rcpp_release_buffers", (DL_FUNC) &_jsonify_rcpp_release_buffers, 0},
+    {"_jsonify_rcpp_json_combine", (DL_FUNC) &_jsonify_rcpp_json_combine, 2},
+    {"_jsonify_rcpp_from_json", (DL_FUNC) &_jsonify_rcpp_from_json, 2},
+    {"_jsonify_rcpp_pretty_json", (DL_FUNC) &_jsonify_rcpp_pretty_json, 2},
     {"_jsonify_rcpp_minify_json", (DL_FUNC) &_jsonify_rcpp_minify_json, 1},
-    {"_jsonify_rcpp_pretty_print", (DL_FUNC) &_jsonify_rcpp_pretty_print, 1},
+    {"_jsonify_rcpp_pretty_print", (DL_FUNC) &_jsonify_rcpp_pretty_print, 2},
     {"_jsonify_source_tests", (DL_FUNC) &_jsonify_source_tests, 0},
-    {"_jsonify_rcpp_to_json", (DL_FUNC) &_jsonify_rcpp_to_json, 6},
-    {"_jsonify_rcpp_validate_json", (DL_FUNC) &_jsonify_rcpp_validate_json, 1},
+    {"_jsonify_rcpp_to_json", (DL_FUNC) &_jsonify_rcpp_to_json, 7},
+    {"_jsonify_rcpp_to_json_subset", (DL_FUNC) &_jsonify_rcpp_to_json_subset, 8},
+    {"_jsonify_rcpp_to_json_each", (DL_FUNC) &_jsonify_rcpp_to_json_each, 6},
+    {"_jsonify_rcpp_to_json_stats", (DL_FUNC) &_jsonify_rcpp_to_json_stats, 6},
+    {"_jsonify_rcpp_to_json_file", (DL_FUNC) &_jsonify_rcpp_to_json_file, 7},
+    {"_jsonify_rcpp_to_ndjson", (DL_FUNC) &_jsonify_rcpp_to_ndjson, 7},
+    {"_jsonify_rcpp_to_ndjson_file", (DL_FUNC) &_jsonify_rcpp_to_ndjson_file, 7},
+    {"_jsonify_rcpp_validate_json", (DL_FUNC) &_jsonify_rcpp_validate_json, 2},
     {NULL, NULL, 0}
 };
 
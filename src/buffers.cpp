@@ -0,0 +1,7 @@
+#include <Rcpp.h>
+#include "jsonify/buffers/buffers.hpp"
+
+// [[Rcpp::export]]
+void rcpp_release_buffers() {
+  jsonify::buffers::release();
+}
@@ -0,0 +1,7 @@
+#include <Rcpp.h>
+#include "jsonify/combine/combine.hpp"
+
+// [[Rcpp::export]]
+Rcpp::StringVector rcpp_json_combine( Rcpp::StringVector json, bool validate = false ) {
+  return jsonify::combine::json_combine( json, validate );
+}
@@ -0,0 +1,8 @@
+
+#include "jsonify/from_json/from_json.hpp"
+#include <Rcpp.h>
+
+// [[Rcpp::export]]
+SEXP rcpp_from_json( const char* json, bool simplify = true ) {
+  return jsonify::from_json::from_json( json, simplify );
+}
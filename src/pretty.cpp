@@ -1,51 +1,22 @@
 
 #include <Rcpp.h>
-using namespace Rcpp;
-
-#include "rapidjson/writer.h"
-#include "rapidjson/prettywriter.h"
-#include "rapidjson/document.h"
-#include "rapidjson/stringbuffer.h"
-
-// reference: https://stackoverflow.com/questions/40833243/rapidjson-pretty-print-using-json-string-as-input-to-the-writer
+#include "jsonify/pretty/pretty.hpp"
 
 // [[Rcpp::export]]
-Rcpp::StringVector rcpp_pretty_json( const char* json ) {
-
-  rapidjson::Document d;
-  d.Parse(json);
-  
-  rapidjson::StringBuffer sb;
-  rapidjson::PrettyWriter< rapidjson::StringBuffer > writer(sb);
-  d.Accept(writer);
-  
-  Rcpp::StringVector js = sb.GetString();
-  js.attr("class") = "json";
-  return js;
+Rcpp::StringVector rcpp_pretty_json( Rcpp::StringVector json, int indent = 4 ) {
+  return jsonify::pretty::pretty_json( json, indent );
 }
 
 // [[Rcpp::export]]
-Rcpp::StringVector rcpp_minify_json( const char* json ) {
-  
-  rapidjson::Document d;
-  d.Parse(json);
-  
-  rapidjson::StringBuffer sb;
-  rapidjson::Writer< rapidjson::StringBuffer > writer(sb);
-  d.Accept(writer);
-  
-  Rcpp::StringVector js = sb.GetString();
-  js.attr("class") = "json";
-  return js;
+Rcpp::StringVector rcpp_minify_json( Rcpp::StringVector json ) {
+  return jsonify::pretty::minify_json( json );
 }
 
 // [[Rcpp::export]]
-void rcpp_pretty_print( const char* json ) {
-  rapidjson::Document d;
-  d.Parse(json);
-  
-  rapidjson::StringBuffer sb;
-  rapidjson::PrettyWriter< rapidjson::StringBuffer > writer(sb);
-  d.Accept(writer);
-  Rcpp::Rcout << sb.GetString() << std::endl;
-}
\ No newline at end of file
+void rcpp_pretty_print( Rcpp::StringVector json, int indent = 4 ) {
+  Rcpp::StringVector js = jsonify::pretty::pretty_json( json, indent );
+  R_xlen_t i;
+  for ( i = 0; i < js.size(); i++ ) {
+    Rcpp::Rcout << CHAR( STRING_ELT( js, i ) ) << std::endl;
+  }
+}
@@ -2,6 +2,7 @@
 #include "jsonify/jsonify.hpp"
 
 #include "rapidjson/writer.h"
+#include "rapidjson/prettywriter.h"
 
 using namespace Rcpp;
 
@@ -179,6 +180,109 @@ void source_tests() {
   res = jsonify::utils::finalise_json( sb );
   json = res[0];
   quick_test("false", json, testcounter);
+  
+  sb.Clear();
+  writer.Reset( sb );
+  
+  jsonify::dates::write_date( writer, -1.0 );
+  res = jsonify::utils::finalise_json( sb );
+  json = res[0];
+  quick_test("\"1969-12-31\"", json, testcounter);
+  
+  sb.Clear();
+  writer.Reset( sb );
+  
+  jsonify::dates::write_posixct( writer, 1514764800.1234 );
+  res = jsonify::utils::finalise_json( sb );
+  json = res[0];
+  quick_test("\"2018-01-01T00:00:00\"", json, testcounter);
+  
+  sb.Clear();
+  writer.Reset( sb );
+  
+  double d = 0.1 + 0.2;
+  jsonify::writers::scalars::write_value( writer, d, 2 );
+  res = jsonify::utils::finalise_json( sb );
+  json = res[0];
+  quick_test("0.3", json, testcounter);
+  
+  sb.Clear();
+  writer.Reset( sb );
+  
+  d = -1000.0501;
+  jsonify::writers::scalars::write_value( writer, d, 3 );
+  res = jsonify::utils::finalise_json( sb );
+  json = res[0];
+  quick_test("-1000.05", json, testcounter);
+  
+  // only a rapidjson::Writer has strings copied straight into its stream,
+  // others write them with their own String()
+  sb.Clear();
+  rapidjson::PrettyWriter < rapidjson::StringBuffer > pretty( sb );
+  pretty.SetIndent( ' ', 2 );
+  pretty.StartArray();
+  jsonify::writers::scalars::write_value( pretty, "a", 1 );
+  jsonify::writers::scalars::write_value( pretty, "b", 1 );
+  pretty.EndArray();
+  json = sb.GetString();
+  quick_test("[\n  \"a\",\n  \"b\"\n]", json, testcounter);
+  
+  sb.Clear();
+  rapidjson::Writer < rapidjson::StringBuffer, rapidjson::UTF8<>, rapidjson::ASCII<> > ascii( sb );
+  jsonify::writers::scalars::write_value( ascii, "\xc3\xa9", 2 );
+  json = sb.GetString();
+  quick_test("\"\\u00E9\"", json, testcounter);
+  
+  // numeric indices of a subset, e.g. from another package, are coerced
+  Rcpp::IntegerMatrix im( 3, 2 );
+  im[0] = 1; im[1] = 2; im[2] = 3; im[3] = 4; im[4] = 5; im[5] = 6;
+  res = jsonify::api::to_json_subset( im, Rcpp::NumericVector::create( 3, 1 ), R_NilValue );
+  json = res[0];
+  quick_test("[[3,6],[1,4]]", json, testcounter);
+  
+  res = jsonify::api::to_json_subset( im, Rcpp::IntegerVector::create( 2 ), Rcpp::NumericVector::create( 2.0 ) );
+  json = res[0];
+  quick_test("[[5]]", json, testcounter);
+  
+  // an estimate of over a GB (a thousand copies of one 1MB string) is only
+  // reserved up to MAX_RESERVE
+  std::string mb( 1024 * 1024, 'a' );
+  sv = Rcpp::StringVector( 1000 );
+  SEXP s = Rf_mkCharLen( mb.data(), static_cast< int >( mb.size() ) );
+  for ( R_xlen_t i = 0; i < sv.size(); i++ ) {
+    SET_STRING_ELT( sv, i, s );
+  }
+  size_t estimate = jsonify::writers::estimate::size( sv, -1, true, true, jsonify::utils::BY_ROW );
+  quick_test( 
+    std::to_string( jsonify::writers::estimate::MAX_RESERVE ), std::to_string( estimate ), testcounter 
+  );
+  
+  // a lease taken while the thread's slot is borrowed gets a slot of its own,
+  // so writing with it doesn't disturb the outer one
+  {
+    jsonify::buffers::lease outer;
+    outer.writer().StartArray();
+    outer.writer().Int( 1 );
+    {
+      jsonify::buffers::lease inner;
+      quick_test( "true", &inner.buffer() != &outer.buffer() ? "true" : "false", testcounter );
+      inner.writer().Int( 2 );
+      json = std::string( inner.buffer().GetString(), inner.buffer().GetSize() );
+      quick_test( "2", json, testcounter );
+      
+      // and a third, from to_json() itself
+      res = jsonify::api::to_json( Rcpp::IntegerVector::create( 3 ) );
+      json = res[0];
+      quick_test( "[3]", json, testcounter );
+    }
+    outer.writer().Int( 4 );
+    outer.writer().EndArray();
+    json = std::string( outer.buffer().GetString(), outer.buffer().GetSize() );
+    quick_test( "[1,4]", json, testcounter );
+  }
+  {
+    // once returned, the thread's slot is borrowed again
+    jsonify::buffers::lease again;
+    quick_test( "true", &again.buffer() == &jsonify::buffers::thread_slot().sb ? "true" : "false", testcounter );
+  }
 }
-
-
@@ -4,12 +4,55 @@
 // [[Rcpp::export]]
 Rcpp::StringVector rcpp_to_json( SEXP lst, bool unbox = false, int digits = -1, 
                                  bool numeric_dates = true, bool factors_as_string = true,
-                                 std::string by = "row") {
-  
-  if ( digits >= 0 ) {
-    SEXP lst2 = Rcpp::clone( lst );
-    return jsonify::api::to_json( lst2, unbox, digits, numeric_dates, factors_as_string, by );
-  }
-  return jsonify::api::to_json( lst, unbox, digits, numeric_dates, factors_as_string, by );
+                                 std::string by = "row", int threads = 1) {
+
+  return jsonify::api::to_json( lst, unbox, digits, numeric_dates, factors_as_string, by, threads );
+}
+
+// [[Rcpp::export]]
+Rcpp::StringVector rcpp_to_json_subset( SEXP x, SEXP rows, SEXP cols, bool unbox = false, int digits = -1, 
+                                        bool numeric_dates = true, bool factors_as_string = true,
+                                        std::string by = "row") {
+
+  return jsonify::api::to_json_subset( x, rows, cols, unbox, digits, numeric_dates, factors_as_string, by );
+}
+
+// [[Rcpp::export]]
+Rcpp::StringVector rcpp_to_json_each( SEXP lst, bool unbox = false, int digits = -1, 
+                                      bool numeric_dates = true, bool factors_as_string = true,
+                                      std::string by = "row") {
+
+  return jsonify::api::to_json_each( lst, unbox, digits, numeric_dates, factors_as_string, by );
+}
+
+// [[Rcpp::export]]
+Rcpp::List rcpp_to_json_stats( SEXP lst, bool unbox = false, int digits = -1, 
+                               bool numeric_dates = true, bool factors_as_string = true,
+                               std::string by = "row") {
+
+  return jsonify::api::to_json_stats( lst, unbox, digits, numeric_dates, factors_as_string, by );
+}
+
+// [[Rcpp::export]]
+void rcpp_to_json_file( SEXP lst, const char* file, bool unbox = false, int digits = -1, 
+                        bool numeric_dates = true, bool factors_as_string = true,
+                        std::string by = "row") {
+
+  jsonify::api::to_json_file( file, lst, unbox, digits, numeric_dates, factors_as_string, by );
+}
+
+// [[Rcpp::export]]
+Rcpp::StringVector rcpp_to_ndjson( SEXP lst, bool unbox = false, int digits = -1, 
+                                   bool numeric_dates = true, bool factors_as_string = true,
+                                   std::string by = "row", bool as_vector = false ) {
+
+  return jsonify::api::to_ndjson( lst, unbox, digits, numeric_dates, factors_as_string, by, as_vector );
 }
 
+// [[Rcpp::export]]
+void rcpp_to_ndjson_file( SEXP lst, const char* file, bool unbox = false, int digits = -1, 
+                          bool numeric_dates = true, bool factors_as_string = true,
+                          std::string by = "row") {
+
+  jsonify::api::to_ndjson_file( file, lst, unbox, digits, numeric_dates, factors_as_string, by );
+}
@@ -3,12 +3,6 @@
 #include <Rcpp.h>
 
 // [[Rcpp::export]]
-Rcpp::LogicalVector rcpp_validate_json( Rcpp::StringVector json ) {
-  int n = json.size();
-  Rcpp::LogicalVector res( n );
-  for ( int i = 0; i < n; i++ ) {
-    res[i] = jsonify::validate::validate_json( json[i] );
-  }
-  return res;
+Rcpp::LogicalVector rcpp_validate_json( Rcpp::StringVector json, int threads = 1 ) {
+  return jsonify::validate::validate_json( json, threads );
 }
-